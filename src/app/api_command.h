@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../lib/model.h"
+#include "game_db.h"
+#include "priority_dispatcher.h"
+
+
+namespace api_handler
+{
+
+/*
+ *  Запросы API, разобранные и проверенные в потоке ввода-вывода.
+ *  В strand передаётся только команда с готовыми аргументами: JSON, заголовки и путь там уже не разбираются.
+ */
+
+struct JoinGameCommand
+{
+    std::string user_name;
+    model::Map * map = nullptr;
+};
+
+struct JoinGameBatchCommand
+{
+    std::vector<std::string> user_names;
+    model::Map * map = nullptr;
+};
+
+// Note: state reads reach the strand only for a player who joined after the last published snapshot
+struct GameStateCommand
+{
+    model::Token token;
+};
+
+struct GamePlayersCommand
+{
+    model::Token token;
+};
+
+struct GameRecordsCommand
+{
+    db::RecordsQuery query;
+    // Note: cursor as sent by the client, the ETag of the page is built from it
+    std::string cursor;
+};
+
+struct GameTickCommand
+{
+    int64_t elapsed_ms = 0;
+};
+
+using ApiCommand = std::variant<JoinGameCommand,
+                                JoinGameBatchCommand,
+                                GameStateCommand,
+                                GamePlayersCommand,
+                                GameRecordsCommand,
+                                GameTickCommand>;
+
+// Priority of the command on the game strand
+inline app::WorkClass GetWorkClass(const ApiCommand & command) noexcept
+{
+    struct Visitor
+    {
+        app::WorkClass operator()(const JoinGameCommand &) const noexcept      { return app::WorkClass::Gameplay; }
+        app::WorkClass operator()(const JoinGameBatchCommand &) const noexcept { return app::WorkClass::Bulk; }
+        app::WorkClass operator()(const GameStateCommand &) const noexcept     { return app::WorkClass::StateRead; }
+        app::WorkClass operator()(const GamePlayersCommand &) const noexcept   { return app::WorkClass::StateRead; }
+        app::WorkClass operator()(const GameRecordsCommand &) const noexcept   { return app::WorkClass::Bulk; }
+        // Note: game/tick from the API is the test-mode clock, it goes with the ticker slices
+        app::WorkClass operator()(const GameTickCommand &) const noexcept      { return app::WorkClass::Tick; }
+    };
+
+    return std::visit(Visitor{}, command);
+}
+
+}   // namespace api_handler
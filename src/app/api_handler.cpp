@@ -1,6 +1,8 @@
 #include "api_handler.h"
 #include "request_handler.h"
 #include "game_db.h"
+#include "../lib/json_loader.h"
+#include "../lib/route_trie.h"
 
 
 using namespace std::string_view_literals;
@@ -13,396 +15,557 @@ namespace api_handler
 {
     constexpr auto API_V1 = "/api/v1/"sv;
     constexpr auto AUTH_BEARER = "Bearer "sv;
-
-    namespace api_v1 {
-        constexpr auto CMD_GAME_JOIN= "game/join"sv;
-        constexpr auto CMD_GAME_PLAYERS = "game/players"sv;
-        constexpr auto GAME_PLAYER = "game/player/"sv;
-        constexpr auto CMD_GAME_STATE = "game/state"sv;
-        constexpr auto CMD_GAME_TICK = "game/tick"sv;
-        constexpr auto CMD_GAME_RECORDS = "game/records"sv;
-        constexpr auto MAPS = "maps"sv;
-        constexpr auto GAME = "game/"sv;
-        constexpr auto CMD_GAME_PLAYER_ACTION = "game/player/action"sv;
+    constexpr auto X_NEXT_CURSOR = "X-Next-Cursor"sv;
+    constexpr size_t MAX_JOIN_BATCH = 1000;
+
+    // Ответы об ошибках, тела собраны на этапе компиляции
+    namespace errors {
+        constexpr ApiError INVALID_TOKEN{http::status::unauthorized,
+            R"json({"code":"invalidToken","message":"Authorization header is missing"})json"sv};
+        // Note: the token is not echoed back, the body stays the same for every unknown token
+        constexpr ApiError UNKNOWN_TOKEN{http::status::unauthorized,
+            R"json({"code":"unknownToken","message":"Player token has not been found"})json"sv};
+
+        constexpr ApiError POST_ONLY{http::status::method_not_allowed,
+            R"json({"code":"invalidMethod","message":"Only POST method is expected"})json"sv, "POST"sv};
+        constexpr ApiError GET_HEAD_ONLY{http::status::method_not_allowed,
+            R"json({"code":"invalidMethod","message":"Only GET, HEAD method is expected"})json"sv, "GET, HEAD"sv};
+
+        constexpr ApiError INVALID_CONTENT_TYPE{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Request content type error. Only application/json allowed"})json"sv};
+        constexpr ApiError PARSE_JSON{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Parse json error"})json"sv};
+        constexpr ApiError INVALID_JSON{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid JSON"})json"sv};
+        constexpr ApiError INVALID_JOIN{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Join game request parse error: userName and mapId"})json"sv};
+        constexpr ApiError INVALID_JOIN_BATCH{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Join batch request parse error: userNames and mapId"})json"sv};
+        constexpr ApiError INVALID_BATCH_SIZE{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid batch size"})json"sv};
+        constexpr ApiError EMPTY_NAME{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid name (empty)"})json"sv};
+        constexpr ApiError TIME_DELTA_ZERO{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid timeDelta value (zero)"})json"sv};
+        constexpr ApiError TIME_DELTA_JSON{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid timeDelta value (json)"})json"sv};
+        constexpr ApiError INVALID_TICK{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid game/tick JSON"})json"sv};
+        constexpr ApiError INVALID_RECORDS{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid game/records JSON"})json"sv};
+        constexpr ApiError INVALID_CURSOR{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"Invalid records cursor"})json"sv};
+        constexpr ApiError MAX_ITEMS{http::status::bad_request,
+            R"json({"code":"invalidArgument","message":"maxItems is too big"})json"sv};
+
+        constexpr ApiError BAD_REQUEST{http::status::bad_request,
+            R"json({"code":"badRequest","message":"Bad request"})json"sv};
+        constexpr ApiError INVALID_API_VERSION{http::status::bad_request,
+            R"json({"code":"badRequest","message":"Invalid REST API version"})json"sv};
+        constexpr ApiError UNKNOWN_PLAYER_COMMAND{http::status::bad_request,
+            R"json({"code":"badRequest","message":"Unknown game/player command"})json"sv};
+        constexpr ApiError INVALID_ENDPOINT{http::status::bad_request,
+            R"json({"code":"badRequest","message":"Invalid endpoint"})json"sv};
+
+        constexpr ApiError MAP_NOT_FOUND{http::status::not_found,
+            R"json({"code":"mapNotFound","message":"Map not found"})json"sv};
+
+        constexpr ApiError SERVICE_UNAVAILABLE{http::status::service_unavailable,
+            R"json({"code":"serviceUnavailable","message":"Server is overloaded, try again later"})json"sv};
+
+        constexpr ApiError UNKNOWN_GAME_COMMAND{http::status::not_implemented,
+            "Unknown game command"sv, {}, ContentType::TEXT_HTML};
     }
-    
 
-    ApiHandler::ApiHandler(model::Game &game, db::ConnectionPool * connection_pool)
-              : connection_pool_(connection_pool)
-    {
-        app_ = std::make_unique<app::Application>(game, connection_pool);
-    }
+    // Методы HTTP, которые принимает маршрут
+    using MethodMask = uint64_t;
 
-    StringResponse ApiHandler::HandleApiMapsRequest(std::string_view target, unsigned version, bool keep_alive) const
-    {
-        StringResponse res;
+    constexpr MethodMask MethodBit(http::verb method) noexcept {
+        const auto bit = static_cast<unsigned>(method);
+        return bit < 64 ? MethodMask{1} << bit : 0;
+    }
 
-        target.remove_prefix(api_v1::MAPS.size());
+    constexpr MethodMask POST       = MethodBit(http::verb::post);
+    constexpr MethodMask GET_HEAD   = MethodBit(http::verb::get) | MethodBit(http::verb::head);
+    constexpr MethodMask ANY_METHOD = ~MethodMask{0};
 
-        if (target.empty())
-            res = OnCmdMaps(version, keep_alive);
-        else if (target.starts_with('/')) {
-            target.remove_prefix(1);
-            res = OnCmdFetchMap(target, version, keep_alive);
-        }
-        else
-            ThrowBadRequest(version, keep_alive, "Bad request"sv);
+    enum class RouteAuth
+    {
+        None,
+        Player,     // Bearer token of a known player
+    };
 
-        return res;
+    struct ApiRoute
+    {
+        using Handler = ApiResult<ApiHandler::DecodedRequest> (ApiHandler::*)(const ApiRequest & req) const;
+
+        std::string_view pattern;
+        MethodMask methods;
+        RouteAuth auth;
+        Handler handler;
+        // Note: a route without a handler always answers with this error
+        const ApiError * reject = nullptr;
+    };
+
+    /*
+     *  Таблица маршрутов API v1.
+     *  Шаблоны путей собираются в префиксное дерево на этапе компиляции,
+     *  ошибка в таблице (повтор маршрута, лишний "*") не даёт собрать сервер.
+     */
+    struct ApiRoutes
+    {
+        static constexpr std::array ROUTES = {
+            ApiRoute{"maps"sv,               GET_HEAD,   RouteAuth::None,   &ApiHandler::OnCmdMaps},
+            ApiRoute{"maps/{id}"sv,          GET_HEAD,   RouteAuth::None,   &ApiHandler::OnCmdFetchMap},
+            ApiRoute{"maps/*"sv,             GET_HEAD,   RouteAuth::None,   nullptr, &errors::MAP_NOT_FOUND},
+            ApiRoute{"game/join"sv,          POST,       RouteAuth::None,   &ApiHandler::DecodeGameJoin},
+            ApiRoute{"game/join/batch"sv,    POST,       RouteAuth::None,   &ApiHandler::DecodeGameJoinBatch},
+            ApiRoute{"game/players"sv,       GET_HEAD,   RouteAuth::Player, &ApiHandler::OnGamePlayersRead},
+            ApiRoute{"game/state"sv,         GET_HEAD,   RouteAuth::Player, &ApiHandler::OnGameStateRead},
+            ApiRoute{"game/records"sv,       GET_HEAD,   RouteAuth::Player, &ApiHandler::DecodeGameRecords},
+            ApiRoute{"game/player/action"sv, POST,       RouteAuth::Player, &ApiHandler::OnGamePlayerAction},
+            ApiRoute{"game/player/*"sv,      POST,       RouteAuth::None,   nullptr, &errors::UNKNOWN_PLAYER_COMMAND},
+            ApiRoute{"game/tick"sv,          POST,       RouteAuth::None,   &ApiHandler::DecodeGameTick},
+            ApiRoute{"game/*"sv,             ANY_METHOD, RouteAuth::None,   nullptr, &errors::UNKNOWN_GAME_COMMAND},
+        };
+
+        static constexpr auto PATTERNS = [] {
+            std::array<std::string_view, ROUTES.size()> patterns{};
+            for (size_t i = 0; i < ROUTES.size(); ++i)
+                patterns[i] = ROUTES[i].pattern;
+            return patterns;
+        }();
+
+        static constexpr util::RouteTrie<32, 1> TRIE{PATTERNS};
+    };
+
+
+    ApiHandler::ApiHandler(model::Game &game, db::RecordsStorage * records_storage, app::LoadController & load_controller)
+             : load_controller_(load_controller)
+    {
+        app_ = std::make_unique<app::Application>(game, records_storage);
     }
 
-    StringResponse ApiHandler::OnGameJoin(std::string_view content_type,
-                                          std::string_view body,
-                                          unsigned version,
-                                          bool keep_alive)
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::DecodeGameJoin(const ApiRequest & req) const
     {
-        StringResponse ret;
+        ApiResult<DecodedRequest> cmd;
+
+        auto parsed_json = ParseJson(req.content_type, req.body);
+        if (!parsed_json)
+            return std::unexpected(parsed_json.error());
 
-        auto parsed_json = ParseJson(content_type, body, version, keep_alive);
+        const auto * pObj      = parsed_json->if_object();
+        const auto * pUserName = pObj ? pObj->if_contains("userName") : nullptr;
+        const auto * pMapId    = pObj ? pObj->if_contains("mapId") : nullptr;
 
-        json::object &objJson = parsed_json.as_object();
-        if (objJson.contains("userName") && objJson.contains("mapId"))
+        if (pUserName && pUserName->is_string() && pMapId && pMapId->is_string())
         {
-            std::string_view userName = objJson["userName"].as_string();
-            std::string_view mapId = objJson["mapId"].as_string();
+            std::string_view userName = pUserName->as_string();
+            std::string_view mapId = pMapId->as_string();
 
+            // Note: maps are loaded at start and never change, so they are looked up here
             if (userName.empty())
-                ThrowInvalidArgument(version, keep_alive, "Invalid name (empty)"sv);
+                cmd = std::unexpected(errors::EMPTY_NAME);
             else if (auto pMap = app_->FindMap(model::Map::Id{std::string(mapId)}); pMap)
-            {
-                auto pPlayer = app_->JoinGame(userName, *pMap);
-                json::object reply;
-                reply["authToken"] = pPlayer->GetToken();
-                reply["playerId"]  = pPlayer->GetId();
-                ret = MakeStringResponse(http::status::ok,
-                                         json::serialize(reply),
-                                         version, keep_alive, ContentType::APP_JSON);
-            }
+                cmd = JoinGameCommand{std::string(userName), pMap};
             else
-                ThrowNotFound(version, keep_alive, "Map not found"sv, "mapNotFound"sv);
+                cmd = std::unexpected(errors::MAP_NOT_FOUND);
         }
         else
-            ThrowInvalidArgument(version, keep_alive, "Join game request parse error: userName and mapId"sv);
+            cmd = std::unexpected(errors::INVALID_JOIN);
 
-        return ret;
+        return cmd;
     }
 
-    StringResponse ApiHandler::OnGamePlayers([[maybe_unused]] std::string_view body,
-                                             std::string_view authorization,
-                                             unsigned version,
-                                             bool keep_alive) const
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::DecodeGameJoinBatch(const ApiRequest & req) const
     {
-        const auto &game_player = FindPlayerByToken(authorization, version, keep_alive);
+        auto parsed_json = ParseJson(req.content_type, req.body);
+        if (!parsed_json)
+            return std::unexpected(parsed_json.error());
+
+        const auto * pObj   = parsed_json->if_object();
+        const auto * pMapId = pObj ? pObj->if_contains("mapId") : nullptr;
+        const auto * pNames = pObj ? pObj->if_contains("userNames") : nullptr;
+
+        if (!pMapId || !pMapId->is_string() || !pNames || !pNames->is_array())
+            return std::unexpected(errors::INVALID_JOIN_BATCH);
+
+        const auto & names = pNames->as_array();
+        if (names.empty() || names.size() > MAX_JOIN_BATCH)
+            return std::unexpected(errors::INVALID_BATCH_SIZE);
+
+        // Note: the whole batch is validated first, it is joined either completely or not at all
+        JoinGameBatchCommand cmd;
+        cmd.user_names.reserve(names.size());
+        for (const auto & name : names) {
+            if (!name.is_string() || name.as_string().empty())
+                return std::unexpected(errors::EMPTY_NAME);
+            cmd.user_names.emplace_back(name.as_string());
+        }
+
+        cmd.map = app_->FindMap(model::Map::Id{std::string(pMapId->as_string())});
+        if (!cmd.map)
+            return std::unexpected(errors::MAP_NOT_FOUND);
+
+        return cmd;
+    }
+
+    StringResponse ApiHandler::OnGameJoin(JoinGameCommand && cmd, unsigned version, bool keep_alive)
+    {
+        auto pPlayer = app_->JoinGame(cmd.user_name, *cmd.map);
 
         json::object reply;
+        reply["authToken"] = pPlayer->GetToken();
+        reply["playerId"]  = pPlayer->GetId();
+
+        return MakeStringResponse(http::status::ok,
+                                  json::serialize(reply),
+                                  version, keep_alive, ContentType::APP_JSON);
+    }
 
-        app_->ForEachPlayerOnMap(game_player.GetAssignedMapId(), [&reply](model::Player &player)
-                                 {
-        json::object j;
-        j["name"sv] = player.GetName();
-        reply[std::to_string(player.GetId())] = std::move(j); });
+    StringResponse ApiHandler::OnGameJoinBatch(JoinGameBatchCommand && cmd, unsigned version, bool keep_alive)
+    {
+        json::array reply;
+        reply.reserve(cmd.user_names.size());
+        for (auto pPlayer : app_->JoinGame(cmd.user_names, *cmd.map)) {
+            json::object j;
+            j["authToken"] = pPlayer->GetToken();
+            j["playerId"]  = pPlayer->GetId();
+            reply.push_back(std::move(j));
+        }
 
         return MakeStringResponse(http::status::ok,
                                   json::serialize(reply),
                                   version, keep_alive, ContentType::APP_JSON);
     }
 
-    StringResponse ApiHandler::OnGamePlayer(std::string_view target,
-                                            std::string_view content_type,
-                                            std::string_view body,
-                                            std::string_view authorization,
-                                            unsigned version,
-                                            bool keep_alive) const
+    ApiResult<StringResponse> ApiHandler::OnGamePlayers(const GamePlayersCommand & cmd, unsigned version, bool keep_alive) const
+    {
+        auto game_player = FindPlayerByToken(cmd.token);
+        if (!game_player)
+            return std::unexpected(game_player.error());
+
+        return MakeStringResponse(http::status::ok,
+                                  app::SerializeSessionPlayers((*game_player)->GetGameSession()),
+                                  version, keep_alive, ContentType::APP_JSON);
+    }
+
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnGamePlayerAction(const ApiRequest & req) const
     {
-        StringResponse ret;
+        ApiResult<DecodedRequest> ret;
 
-        if (target == api_v1::CMD_GAME_PLAYER_ACTION)
+        auto json_req = ParseJson(req.content_type, req.body);
+        if (!json_req)
+            return std::unexpected(json_req.error());
+
+        if (json_req->is_object())
         {
-            const auto &game_player = FindPlayerByToken(authorization, version, keep_alive);
-            if (auto json_req = ParseJson(content_type, body, version, keep_alive); json_req.is_object())
+            if (auto it = json_req->as_object().find("move"sv); it != json_req->as_object().end() && it->value().is_string())
             {
-                if (auto it = json_req.as_object().find("move"sv); it != json_req.as_object().end())
-                {
-                    float fSpeed = app_->GetDefaultDogSpeed();
-                    if (auto speed = game_player.GetAssignedMap().GetDogSpeed(); speed)
-                        fSpeed = *speed;
-
-                    game_player.GetDog()->SetDirectionCode(it->value().as_string(), fSpeed);
+                // Note: the dog is not touched here, the next tick applies all queued moves in one pass
+                app_->PostPlayerCommand({req.token, std::string(it->value().as_string())});
 
-                    ret = MakeStringResponse(http::status::ok,
-                                             "{}"sv,
-                                             version, keep_alive, ContentType::APP_JSON);
-                }
-                else
-                    ThrowInvalidArgument(version, keep_alive, "Invalid JSON"sv);
+                ret = MakeStringResponse(http::status::ok,
+                                         "{}"sv,
+                                         req.version, req.keep_alive, ContentType::APP_JSON);
             }
             else
-                ThrowInvalidArgument(version, keep_alive, "Invalid JSON"sv);
+                ret = std::unexpected(errors::INVALID_JSON);
         }
         else
-            ThrowBadRequest(version, keep_alive, "Unknown game/player command"sv);
+            ret = std::unexpected(errors::INVALID_JSON);
 
         return ret;
     }
 
-    StringResponse ApiHandler::OnGameTick(std::string_view content_type,
-                                          std::string_view body,
-                                          unsigned version,
-                                          bool keep_alive) const
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::DecodeGameTick(const ApiRequest & req) const
     {
-        StringResponse ret;
+        GameTickCommand cmd;
 
         if (!app_->IsAllowedExternalGameTick())
-            ThrowBadRequest(version, keep_alive, "Invalid endpoint");
+            return std::unexpected(errors::INVALID_ENDPOINT);
 
-        if (auto json_req = ParseJson(content_type, body, version, keep_alive); json_req.is_object())
+        auto json_req = ParseJson(req.content_type, req.body);
+        if (!json_req)
+            return std::unexpected(json_req.error());
+
+        if (json_req->is_object())
         {
-            if (auto it = json_req.as_object().find("timeDelta"sv);
-                it != json_req.as_object().end() && it->value().is_number())
+            if (auto it = json_req->as_object().find("timeDelta"sv);
+                it != json_req->as_object().end() && it->value().is_number())
             {
-                int64_t elapsedMs = 0;
-
                 if (it->value().is_int64())
-                    elapsedMs = it->value().as_int64();
+                    cmd.elapsed_ms = it->value().as_int64();
                 else if (it->value().is_uint64())
-                    elapsedMs = (int64_t)it->value().as_uint64();
+                    cmd.elapsed_ms = (int64_t)it->value().as_uint64();
                 else if (it->value().is_double())
-                    elapsedMs = (int64_t)it->value().as_double();
+                    cmd.elapsed_ms = (int64_t)it->value().as_double();
 
-                if (elapsedMs > 0)
-                {
-                    app_->ProcessGameTick(elapsedMs);
-
-                    ret = MakeStringResponse(http::status::ok,
-                                             "{}"sv,
-                                             version, keep_alive, ContentType::APP_JSON);
-                }
-                else
-                    ThrowInvalidArgument(version , keep_alive, "Invalid timeDelta value (zero)"sv);
+                if (cmd.elapsed_ms <= 0)
+                    return std::unexpected(errors::TIME_DELTA_ZERO);
             }
             else
-                ThrowInvalidArgument(version , keep_alive, "Invalid timeDelta value (json)"sv);
+                return std::unexpected(errors::TIME_DELTA_JSON);
         }
         else
-            ThrowInvalidArgument(version , keep_alive, "Invalid game/tick JSON"sv);
+            return std::unexpected(errors::INVALID_TICK);
 
-        return ret;
+        return cmd;
     }
 
-    StringResponse ApiHandler::OnGameState(std::string_view authorization, unsigned version, bool keep_alive) const
+    StringResponse ApiHandler::OnGameTick(const GameTickCommand & cmd, unsigned version, bool keep_alive) const
     {
-        const auto &game_player = FindPlayerByToken(authorization, version, keep_alive);
-        json::object reply;
-        reply["players"] = json::object();
+        const auto started = app::LoadController::Clock::now();
+        app_->ProcessGameTick(cmd.elapsed_ms);
+        load_controller_.OnTick(app::LoadController::Clock::now() - started);
+
+        return MakeStringResponse(http::status::ok,
+                                  "{}"sv,
+                                  version, keep_alive, ContentType::APP_JSON);
+    }
 
-        app_->ForEachPlayerOnMap(game_player.GetAssignedMapId(), [&reply](model::Player &player) {
-            if (auto pDog = player.GetDog(); pDog) {
-                auto         pos = pDog->GetPosition();
-                const auto & vel = pDog->GetVelocity();
+    ApiResult<StringResponse> ApiHandler::OnGameState(const GameStateCommand & cmd, unsigned version, bool keep_alive) const
+    {
+        auto game_player = FindPlayerByToken(cmd.token);
+        if (!game_player)
+            return std::unexpected(game_player.error());
 
-                json::object data;
-                data["pos"]   = json::array( { pos.x, pos.y } );
-                data["speed"] = json::array( { vel.x, vel.y } );
-                data["dir"]   = pDog->GetDirectionCode();
+        // Note: only a player who joined after the last published snapshot gets here
+        return MakeStringResponse(http::status::ok,
+                                  app::SerializeSessionState((*game_player)->GetGameSession()),
+                                  version, keep_alive, ContentType::APP_JSON);
+    }
 
-                json::array bag;
-                for (const auto & p : pDog->GetGatheredItems()) {
-                    json::object loot;
-                    loot["id"] = p->id;
-                    loot["type"] = p->type;
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::DecodeGameRecords(const ApiRequest & req) const
+    {
+        // Note: leaderboard is not needed to play, it is the first to go under load
+        if (load_controller_.IsOverloaded())
+            return std::unexpected(errors::SERVICE_UNAVAILABLE);
 
-                    bag.push_back(std::move(loot));
-                }
-                data["bag"] = std::move(bag);
-                data["score"] = pDog->GetScore();
+        GameRecordsCommand cmd;
+        uint64_t maxItems = db::MAX_NUM_RECORD_ITEMS;
 
-                reply["players"].as_object().insert_or_assign(std::to_string(player.GetId()),
-                                                              std::move(data));
-            }
-        });
+        if (!req.body.empty()) {
+            std::error_code ec;
+            auto req_json = json::parse(req.body, ec);
+            if (ec || !req_json.is_object())
+                return std::unexpected(errors::INVALID_RECORDS);
 
-        auto & session = game_player.GetGameSession();
-        if (!session.GetLootInstances().empty()) {
-            reply["lostObjects"] = json::object();
-            auto & lostObjects = reply["lostObjects"].as_object();
+            const auto & req_params = req_json.as_object();
 
-            for (const auto & itLoot : session.GetLootInstances()) {
+            // Note: a small number is parsed as int64, negative and fractional values are rejected
+            if (auto it = req_params.find("start"sv); it != req_params.end()) {
+                auto start = json_loader::GetUint64(it->value());
+                if (!start)
+                    return std::unexpected(errors::INVALID_RECORDS);
+                cmd.query.start = *start;
+            }
 
-                json::object data;
-                data["type"sv] = itLoot->type;
-                data["pos"sv] = json::array( { itLoot->pos.x, itLoot->pos.y } );
+            if (auto it = req_params.find("maxItems"sv); it != req_params.end()) {
+                auto items = json_loader::GetUint64(it->value());
+                if (!items)
+                    return std::unexpected(errors::INVALID_RECORDS);
+                maxItems = *items;
+            }
 
-                lostObjects.insert_or_assign(std::to_string(itLoot->id), std::move(data));
+            // Note: keyset pagination, cursor is taken from X-Next-Cursor of the previous page
+            if (auto it = req_params.find("cursor"sv); it != req_params.end() && it->value().is_string()) {
+                cmd.cursor = it->value().as_string();
+                cmd.query.after = db::DecodeRecordCursor(cmd.cursor);
+                if (!cmd.query.after)
+                    return std::unexpected(errors::INVALID_CURSOR);
             }
         }
 
-        return MakeStringResponse(http::status::ok,
-                                  json::serialize(reply),
-                                  version, keep_alive, ContentType::APP_JSON);
+        if (maxItems > db::MAX_NUM_RECORD_ITEMS)
+            return std::unexpected(errors::MAX_ITEMS);
+
+        cmd.query.maxItems = maxItems;
+
+        return cmd;
     }
 
-    StringResponse ApiHandler::OnGameRecords(std::string_view authorization,
-                                             std::string_view body,
-                                             unsigned version,
-                                             bool keep_alive) const
+    std::optional<StringResponse> ApiHandler::OnGameRecords(GameRecordsCommand && cmd,
+                                                            unsigned version,
+                                                            bool keep_alive,
+                                                            const ResponseSender & sender) const
     {
-        const auto &game_player = FindPlayerByToken(authorization, version, keep_alive);
-        auto req_json = json::parse(body);
-        const auto & req_params = req_json.as_object();
+        const auto & query = cmd.query;
+        const auto maxItems = query.maxItems;
 
-        uint64_t offset = 0;
-        uint64_t maxItems = db::MAX_NUM_RECORD_ITEMS;
+        auto make_reply = [version, keep_alive, maxItems](const db::RecordItems & records, std::string_view etag) {
+            json::array reply;
+
+            for (const auto & item : records) {
+                json::object p;
+                p["name"sv] = item.name;
+                p["score"sv] = item.score;
+                p["playTime"] = static_cast<double>(item.play_time_ms) / 1000.0;
 
-        if (auto it = req_params.find("start"sv); it != req_params.end() && it->value().is_number())
-            offset = it->value().as_uint64();
+                reply.push_back(std::move(p));
+            }
 
-        if (auto it = req_params.find("maxItems"sv); it != req_params.end() && it->value().is_number())
-            maxItems = it->value().as_uint64();
+            auto ret = MakeStringResponse(http::status::ok,
+                                          json::serialize(reply),
+                                          version, keep_alive, ContentType::APP_JSON);
+            if (!etag.empty())
+                ret.set(http::field::etag, etag);
 
-        if (maxItems <= db::MAX_NUM_RECORD_ITEMS) {
-            json::array reply;
+            if (!records.empty() && records.size() == maxItems)
+                ret.set(X_NEXT_CURSOR, db::EncodeRecordCursor(records.back()));
 
-            if (connection_pool_) {
-                auto conn_wrp = connection_pool_->GetConnection();
-                auto records = db::FetchRecords(*conn_wrp, offset, maxItems);
-                for (const auto & item : records) {
-                    json::object p;
-                    p["name"sv] = item.name;
-                    p["score"sv] = item.score;
-                    p["playTime"] = item.playtime;
+            return ret;
+        };
 
-                    reply.push_back(std::move(p));
-                }
-            }
+        if (auto records = app_->GetCachedRecords(query); records) {
+            const auto page = query.after ? std::hash<std::string_view>{}(cmd.cursor) : query.start;
+            auto etag = '"' + std::to_string(app_->GetRecordsVersion()) + '-' +
+                        std::to_string(page) + '-' + std::to_string(maxItems) + '"';
 
-            return MakeStringResponse(http::status::ok,
-                                      json::serialize(reply),
-                                      version, keep_alive, ContentType::APP_JSON);
-        }
-        else {
-            ThrowInvalidArgument(version, keep_alive, "maxItems is too big"sv);
+            return make_reply(*records, etag);
         }
 
-        return { };
+        // Note: cache miss, the strand is released while the query is running
+        app_->FetchRecords(query, [sender, make_reply](db::RecordItems && records) {
+            auto ret = make_reply(records, ""sv);
+            ret.set(http::field::cache_control, "no-cache"sv);
+            sender(std::move(ret));
+        });
+
+        return std::nullopt;
     }
 
-    StringResponse ApiHandler::HandleApiGameRequest(http::verb method,
-                                                    std::string_view target,
-                                                    std::string_view content_type,
-                                                    std::string_view body,
-                                                    std::string_view authorization,
-                                                    unsigned version,
-                                                    bool keep_alive)
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::HandleApiRequestV1(http::verb method,
+                                                                         std::string_view target,
+                                                                         std::string_view content_type,
+                                                                         std::string_view body,
+                                                                         std::string_view authorization,
+                                                                         unsigned version,
+                                                                         bool keep_alive) const
     {
-        StringResponse ret;
+        // Note: 405 is only for a known route, a path without one is a bad request whatever the method
+        const auto match = ApiRoutes::TRIE.Find(target);
+        if (!match)
+            return std::unexpected(errors::INVALID_ENDPOINT);
 
-        if (target == api_v1::CMD_GAME_JOIN)
-        {
-            if (method == http::verb::post)
-                ret = OnGameJoin(content_type, body, version, keep_alive);
-            else
-                ThrowPostOnlyExpected(version, keep_alive);
-        }
-        else if (target == api_v1::CMD_GAME_PLAYERS)
-        {
-            if (method == http::verb::get || method == http::verb::head)
-                ret = OnGamePlayers(body, authorization, version, keep_alive);
-            else
-                ThrowGetHeadOnlyExpected(version, keep_alive);
-        }
-        else if (target == api_v1::CMD_GAME_STATE)
-        {
-            if (method == http::verb::get || method == http::verb::head)
-                ret = OnGameState(authorization, version, keep_alive);
-            else
-                ThrowGetHeadOnlyExpected(version, keep_alive);
-        }
-        else if (target == api_v1::CMD_GAME_RECORDS)
-        {
-            if (method == http::verb::get || method == http::verb::head)
-                ret = OnGameRecords(authorization, body, version, keep_alive);
-            else
-                ThrowGetHeadOnlyExpected(version, keep_alive);
-        }
-        else if (target.starts_with(api_v1::GAME_PLAYER))
-        {
-            if (method == http::verb::post)
-                ret = OnGamePlayer(target, content_type, body, authorization, version, keep_alive);
-            else
-                ThrowPostOnlyExpected(version, keep_alive);
-        }
-        else if (target == api_v1::CMD_GAME_TICK)
-        {
-            if (method == http::verb::post)
-                ret = OnGameTick(content_type, body, version, keep_alive);
-            else
-                ThrowPostOnlyExpected(version, keep_alive);
-        }
-        else
-        {
-            ret = MakeStringResponse(http::status::not_implemented,
-                                     "Unknown game command",
-                                     version, keep_alive, ContentType::TEXT_HTML);
+        const auto & route = ApiRoutes::ROUTES[match->route];
+        if (!(route.methods & MethodBit(method)))
+            return std::unexpected(route.methods == POST ? errors::POST_ONLY : errors::GET_HEAD_ONLY);
+
+        if (route.reject)
+            return std::unexpected(*route.reject);
+
+        ApiRequest req{method, content_type, body, match->params[0], {}, std::nullopt, version, keep_alive};
+
+        if (route.auth == RouteAuth::Player) {
+            auto token = ParseAuthToken(authorization);
+            if (!token)
+                return std::unexpected(token.error());
+
+            // Note: the token directory is thread safe, unknown players never reach a handler
+            req.route = app_->FindPlayerRoute(*token);
+            if (!req.route)
+                return std::unexpected(errors::UNKNOWN_TOKEN);
+
+            req.token = std::move(*token);
         }
 
-        return ret;
+        return (this->*route.handler)(req);
     }
 
-    StringResponse ApiHandler::HandleApiRequestV1(http::verb method,
-                                                  std::string_view target,
-                                                  std::string_view content_type,
-                                                  std::string_view body,
-                                                  std::string_view authorization,
-                                                  unsigned version,
-                                                  bool keep_alive)
+
+
+    ApiHandler::DecodedRequest ApiHandler::HandleApiRequest(http::verb method,
+                                                            std::string_view target,
+                                                            std::string_view content_type,
+                                                            std::string_view body,
+                                                            std::string_view authorization,
+                                                            unsigned version,
+                                                            bool keep_alive) const
     {
-        StringResponse ret;
+        ApiResult<DecodedRequest> decoded;
 
-        if (target.starts_with(api_v1::MAPS)) {
-            if (http::verb::get == method || http::verb::head == method)
-                ret = HandleApiMapsRequest(target, version, keep_alive);
-            else
-                ThrowGetHeadOnlyExpected(version, keep_alive);
+        if (target.starts_with(API_V1)) {
+            target.remove_prefix(API_V1.size());
+            decoded = HandleApiRequestV1(method, target, content_type, body, authorization, version, keep_alive);
         }
-        else if (target.starts_with(api_v1::GAME))
-            ret = HandleApiGameRequest(method, target, content_type, body, authorization, version, keep_alive);
         else
-            ThrowMethodNotAllowed(version, keep_alive, "Invalid HTTP method"sv, "");
+            decoded = std::unexpected(errors::INVALID_API_VERSION);
 
-        ret.set(http::field::cache_control, "no-cache"sv);
+        DecodedRequest res = decoded ? std::move(*decoded)
+                                     : DecodedRequest{MakeErrorResponse(decoded.error(), version, keep_alive)};
 
-        return ret;
+        if (auto * rsp = std::get_if<StringResponse>(&res))
+            rsp->set(http::field::cache_control, "no-cache"sv);
+
+        return res;
     }
 
-    StringResponse ApiHandler::HandleApiRequest(http::verb method,
-                                                std::string_view target,
-                                                std::string_view content_type,
-                                                std::string_view body,
-                                                std::string_view authorization,
-                                                unsigned version,
-                                                bool keep_alive)
+    std::optional<StringResponse> ApiHandler::ExecuteApiCommand(ApiCommand && command,
+                                                                unsigned version,
+                                                                bool keep_alive,
+                                                                const ResponseSender & sender)
     {
-        StringResponse res;
-
-        try
-        {
-            if (target.starts_with(API_V1)) {
-                target.remove_prefix(API_V1.size());
-                res = HandleApiRequestV1(method, target, content_type, body, authorization, version, keep_alive);
-            }
+        auto respond = [&](ApiResult<StringResponse> && rsp) -> std::optional<StringResponse> {
+            if (!rsp)
+                return MakeErrorResponse(rsp.error(), version, keep_alive);
+            return std::move(*rsp);
+        };
+
+        auto res = std::visit([&](auto && cmd) -> std::optional<StringResponse> {
+            using Cmd = std::decay_t<decltype(cmd)>;
+
+            if constexpr (std::is_same_v<Cmd, JoinGameCommand>)
+                return OnGameJoin(std::move(cmd), version, keep_alive);
+            else if constexpr (std::is_same_v<Cmd, JoinGameBatchCommand>)
+                return OnGameJoinBatch(std::move(cmd), version, keep_alive);
+            else if constexpr (std::is_same_v<Cmd, GameStateCommand>)
+                return respond(OnGameState(cmd, version, keep_alive));
+            else if constexpr (std::is_same_v<Cmd, GamePlayersCommand>)
+                return respond(OnGamePlayers(cmd, version, keep_alive));
+            else if constexpr (std::is_same_v<Cmd, GameRecordsCommand>)
+                return OnGameRecords(std::move(cmd), version, keep_alive, sender);
             else
-                ThrowBadRequest(version, keep_alive, "Invalid REST API version"sv);
-        }
-        catch (const ApiHandlerException & err)
-        {
-            res = err.GetStringResponse();
-        }
+                return OnGameTick(cmd, version, keep_alive);
+        }, std::move(command));
+
+        if (res)
+            res->set(http::field::cache_control, "no-cache"sv);
 
         return res;
     }
 
-    StringResponse ApiHandler::OnCmdMaps(unsigned version, bool keep_alive) const
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnGameStateRead(const ApiRequest & req) const
+    {
+        return OnGameSnapshotRead(req, true);
+    }
+
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnGamePlayersRead(const ApiRequest & req) const
     {
+        return OnGameSnapshotRead(req, false);
+    }
+
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnGameSnapshotRead(const ApiRequest & req, bool state) const
+    {
+        // Note: a player who joined after the last tick is not in the snapshot yet, the strand answers then
+        auto snapshot = app_->FindSessionSnapshot(req.route->session);
+        if (!snapshot || !snapshot->HasPlayer(req.route->player)) {
+            if (state)
+                return GameStateCommand{req.token};
+            return GamePlayersCommand{req.token};
+        }
+
+        return MakeStringResponse(http::status::ok,
+                                  state ? snapshot->state_body : snapshot->players_body,
+                                  req.version, req.keep_alive, ContentType::APP_JSON);
+    }
+
+
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnCmdMaps(const ApiRequest & req) const
+    {
+        if (load_controller_.IsOverloaded())
+            return std::unexpected(errors::SERVICE_UNAVAILABLE);
+
         json::array jsonMaps;
 
         for (const auto &map : app_->GetMaps())
@@ -417,14 +580,14 @@ namespace api_handler
 
         return MakeStringResponse(http::status::ok,
                                   json::serialize(jsonMaps),
-                                  version, keep_alive, ContentType::APP_JSON);
+                                  req.version, req.keep_alive, ContentType::APP_JSON);
     }
 
-    StringResponse ApiHandler::OnCmdFetchMap(std::string_view mapName, unsigned version, bool keep_alive) const
+    ApiResult<ApiHandler::DecodedRequest> ApiHandler::OnCmdFetchMap(const ApiRequest & req) const
     {
-        StringResponse ret;
+        ApiResult<DecodedRequest> ret;
 
-        std::string sIdMap{mapName};
+        std::string sIdMap{req.param};
         if (auto pMap = app_->FindMap(model::Map::Id(sIdMap)); pMap)
         {
             json::object jsonMap;
@@ -529,126 +692,68 @@ namespace api_handler
 
             ret = MakeStringResponse(http::status::ok,
                                      json::serialize(jsonMap),
-                                     version, keep_alive,
+                                     req.version, req.keep_alive,
                                      ContentType::APP_JSON);
         }
         else
-            ThrowNotFound(version, keep_alive, "Map not found"sv, "mapNotFound"sv);
+            ret = std::unexpected(errors::MAP_NOT_FOUND);
 
         return ret;
     }
 
-    model::Player & ApiHandler::FindPlayerByToken(std::string_view authorization,
-                                                  unsigned version,
-                                                  bool keep_alive) const
+
+    ApiResult<model::Player *> ApiHandler::FindPlayerByToken(const model::Token & token) const
+    {
+        // Note: the player may have retired since the request was decoded
+        auto pPlayer = app_->FindPlayerByToken(token);
+        if (!pPlayer)
+            return std::unexpected(errors::UNKNOWN_TOKEN);
+
+        return pPlayer;
+    }
+
+
+    ApiResult<model::Token> ApiHandler::ParseAuthToken(std::string_view authorization)
     {
         if (authorization.starts_with(AUTH_BEARER) && authorization.size() == AUTH_BEARER.size() + model::TOKEN_HEX_LENGTH)
         {
             authorization.remove_prefix(AUTH_BEARER.size());
-
-            model::Token token{authorization};
-
-            if (auto pPlayer = app_->FindPlayerByToken(token); pPlayer)
-                return *pPlayer;
-            else
-            {
-                json::object jsonErr;
-                jsonErr["code"] = "unknownToken"sv;
-                jsonErr["message"] = "Unknown token: \'"s + token + '\'';
-
-                auto err = MakeStringResponse(http::status::unauthorized,
-                                              json::serialize(jsonErr),
-                                              version, keep_alive,
-                                              ContentType::APP_JSON);
-                throw ApiHandlerException{ std::move(err) };
-            }
+            return model::Token{authorization};
         }
-        else
-        {
-            json::object jsonErr;
-            jsonErr["code"sv]    = "invalidToken"sv;
-            jsonErr["message"sv] = "Authorization header is missing"sv;
 
-            auto rsp = MakeStringResponse(http::status::unauthorized,
-                                          json::serialize(jsonErr),
-                                          version, keep_alive, ContentType::APP_JSON);
-            throw ApiHandlerException{ std::move(rsp) };
-        }
+        return std::unexpected(errors::INVALID_TOKEN);
     }
 
-    json::value ApiHandler::ParseJson(std::string_view content_type, std::string_view body, unsigned version, bool keep_alive)
+    ApiResult<json::value> ApiHandler::ParseJson(std::string_view content_type, std::string_view body)
     {
-        json::value ret;
+        ApiResult<json::value> ret;
 
         if (content_type == ContentType::APP_JSON)
         {
-            try {
-                ret = json::parse(body);
-            } catch (const std::exception &e) {
-                ThrowInvalidArgument(version, keep_alive, "Parse json error: "s + e.what());
-            }
+            // Note: malformed body is reported through ec, the parser does not throw
+            std::error_code ec;
+            ret = json::parse(body, ec);
+            if (ec)
+                ret = std::unexpected(errors::PARSE_JSON);
         }
         else
-            ThrowInvalidArgument(version, keep_alive, "Request content type error. Only application/json allowed"sv);
+            ret = std::unexpected(errors::INVALID_CONTENT_TYPE);
 
         return ret;
     }
 
-    void ApiHandler::ThrowMethodNotAllowed(unsigned version, bool keep_alive, std::string_view message, std::string_view allow, std::string_view code)
-    {
-        json::object err;
-        err["code"sv]    = code;
-        err["message"sv] = message;
-
-        auto obj = MakeStringResponse(http::status::method_not_allowed,
-                                                 json::serialize(err),
-                                                 version,
-                                                 keep_alive,
-                                                 ContentType::APP_JSON);
-        obj.set(http::field::allow, allow);
-        obj.set(http::field::cache_control, "no-cache"sv);
-
-        throw ApiHandlerException{ std::move(obj) };
-    }
-
-    void ApiHandler::ThrowPostOnlyExpected(unsigned version, bool keep_alive)
+    StringResponse ApiHandler::MakeErrorResponse(const ApiError & error, unsigned version, bool keep_alive) const
     {
-        ThrowMethodNotAllowed(version, keep_alive, "Only POST method is expected"sv, "POST"sv);
-    }
-
-    void ApiHandler::ThrowGetHeadOnlyExpected(unsigned version, bool keep_alive)
-    {
-        ThrowMethodNotAllowed(version, keep_alive, "Only GET, HEAD method is expected"sv, "GET, HEAD"sv);
-    }
+        auto rsp = MakeStringResponse(error.status,
+                                      error.body,
+                                      version, keep_alive, error.content_type);
 
-    void ApiHandler::ThrowInvalidArgument(unsigned version, bool keep_alive, std::string_view message)
-    {
-        ThrowBadRequest(version, keep_alive, message, "invalidArgument"sv);
-    }
+        if (!error.allow.empty())
+            rsp.set(http::field::allow, error.allow);
 
-    void ApiHandler::ThrowBadRequest(unsigned version, bool keep_alive, std::string_view message, std::string_view code)
-    {
-        json::object err;
-        err["code"sv]    = code;
-        err["message"sv] = message;
-
-        auto obj = MakeStringResponse(http::status::bad_request,
-                                      json::serialize(err),
-                                      version, keep_alive, ContentType::APP_JSON);
-        obj.set(http::field::cache_control, "no-cache"sv);
-        throw ApiHandlerException{ std::move(obj) };
-    }
+        if (error.status == http::status::service_unavailable)
+            rsp.set(http::field::retry_after, std::to_string(load_controller_.GetRetryAfter().count()));
 
-    void ApiHandler::ThrowNotFound(unsigned version, bool keep_alive, std::string_view message, std::string_view code)
-    {
-        json::object err;
-        err["code"sv]    = code;
-        err["message"sv] = message;
-
-        auto obj = MakeStringResponse(http::status::not_found,
-                                      json::serialize(err),
-                                      version, keep_alive, ContentType::APP_JSON);
-        obj.set(http::field::cache_control, "no-cache"sv);
-        throw ApiHandlerException{ std::move(obj) };
+        return rsp;
     }
 }
@@ -2,10 +2,15 @@
 
 #include "http_server.h"
 #include "app.h"
-#include "connection_pool.h"
+#include "records_storage.h"
+#include "load_controller.h"
+#include "api_command.h"
 
 #include <boost/json.hpp>
 
+#include <expected>
+#include <variant>
+
 namespace api_handler
 {
 namespace sys   = boost::system;
@@ -15,22 +20,46 @@ namespace asio  = boost::asio;
 namespace json  = boost::json;
 
 using StringResponse = http::response<http::string_body>;
+// Sends the response of a request completed asynchronously
+using ResponseSender = std::function<void(StringResponse && response)>;
 
 
-class ApiHandlerException : public std::exception
+/*
+ *  Ошибка запроса API.
+ *  Тела ответов об ошибках собраны заранее и не меняются, поэтому ответ на плохой запрос
+ *  стоит столько же, сколько ответ на обычный: без исключений и без сборки JSON.
+ */
+struct ApiError
 {
-public:
-    
-    explicit ApiHandlerException(StringResponse && rsp) : response_(std::move(rsp)) {
-    }
+    http::status status;
+    std::string_view body;
+    // Note: set for 405, the methods the endpoint accepts
+    std::string_view allow = {};
+    std::string_view content_type = "application/json";
+};
 
-    [[nodiscard]] const StringResponse & GetStringResponse() const noexcept {
-        return response_;
-    }
+template <typename T>
+using ApiResult = std::expected<T, ApiError>;
 
-private:
-    
-    StringResponse response_;
+namespace errors {
+    // Note: the rest of the catalogue is in api_handler.cpp, this one is also sent by RequestHandler
+    constexpr ApiError REQUEST_EXPIRED{http::status::service_unavailable,
+        R"json({"code":"requestTimeout","message":"Request deadline expired in the queue"})json"};
+}
+
+// Запрос, который маршрутизатор передаёт обработчику маршрута
+struct ApiRequest
+{
+    http::verb method;
+    std::string_view content_type;
+    std::string_view body;
+    // Note: value of the {id} segment of the route, if it has one
+    std::string_view param;
+    // Note: set for routes which require a known player
+    model::Token token;
+    std::optional<model::PlayerRoute> route;
+    unsigned version;
+    bool keep_alive;
 };
 
 
@@ -40,96 +69,106 @@ class ApiHandler
 
 public:
 
-    ApiHandler(model::Game &game, db::ConnectionPool * connection_pool);
-    
-    StringResponse HandleApiRequest(http::verb method,
+    // Response completed on the I/O thread or a command which has to run on the game strand
+    using DecodedRequest = std::variant<StringResponse, ApiCommand>;
+
+    ApiHandler(model::Game &game, db::RecordsStorage * records_storage, app::LoadController & load_controller);
+
+    // Thread safe. Parses and validates the request; bad requests and requests which need no game state
+    // (player actions, snapshot reads, maps) are answered right away
+    DecodedRequest HandleApiRequest(http::verb method,
                                     std::string_view target,
                                     std::string_view content_type,
                                     std::string_view body,
                                     std::string_view authorization,
                                     unsigned version,
-                                    bool keep_alive);
-    StringResponse HandleApiRequestV1(http::verb method,
-                                      std::string_view target,
-                                      std::string_view content_type,
-                                      std::string_view body,
-                                      std::string_view authorization,
-                                      unsigned version,
-                                      bool keep_alive);
-    [[nodiscard]] StringResponse HandleApiMapsRequest(std::string_view target,
-                                                      unsigned version,
-                                                      bool keep_alive) const;
-    StringResponse HandleApiGameRequest(http::verb method,
-                                        std::string_view target,
-                                        std::string_view content_type,
-                                        std::string_view body,
-                                        std::string_view authorization,
-                                        unsigned version,
-                                        bool keep_alive);
-    StringResponse OnGameJoin(std::string_view content_type,
-                              std::string_view body,
+                                    bool keep_alive) const;
+
+    // Must be called inside the strand.
+    // std::nullopt means the request is completed asynchronously and the response goes to sender
+    std::optional<StringResponse> ExecuteApiCommand(ApiCommand && command,
+                                                    unsigned version,
+                                                    bool keep_alive,
+                                                    const ResponseSender & sender);
+
+    // Game tick from the server ticker, retired players go to the records
+    void ProcessGameTick(int64_t elapsedMs) {
+        app_->ProcessGameTick(elapsedMs);
+    }
+
+    void BeginGameTick(int64_t elapsedMs) {
+        app_->BeginGameTick(elapsedMs);
+    }
+
+    bool StepGameTick(model::TimePoint deadline) {
+        return app_->StepGameTick(deadline);
+    }
+
+    // Ответ из заранее собранного тела ошибки
+    [[nodiscard]] StringResponse MakeErrorResponse(const ApiError & error,
+                                                   unsigned version,
+                                                   bool keep_alive) const;
+
+private:
+
+    // Таблица маршрутов API, см. api_handler.cpp
+    friend struct ApiRoutes;
+
+    // Поиск маршрута, проверка метода и авторизации
+    ApiResult<DecodedRequest> HandleApiRequestV1(http::verb method,
+                                                 std::string_view target,
+                                                 std::string_view content_type,
+                                                 std::string_view body,
+                                                 std::string_view authorization,
+                                                 unsigned version,
+                                                 bool keep_alive) const;
+
+    // Обработчики маршрутов, выполняются в потоке ввода-вывода
+    [[nodiscard]] ApiResult<DecodedRequest> OnCmdMaps(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> OnCmdFetchMap(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> DecodeGameJoin(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> DecodeGameJoinBatch(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> DecodeGameTick(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> DecodeGameRecords(const ApiRequest & req) const;
+    // The move is queued for the next tick
+    [[nodiscard]] ApiResult<DecodedRequest> OnGamePlayerAction(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> OnGameStateRead(const ApiRequest & req) const;
+    [[nodiscard]] ApiResult<DecodedRequest> OnGamePlayersRead(const ApiRequest & req) const;
+    // Answers from the published snapshot, or a command if there is no snapshot with the player yet
+    [[nodiscard]] ApiResult<DecodedRequest> OnGameSnapshotRead(const ApiRequest & req,
+                                                               bool state) const;
+
+    // Выполнение команд в strand
+    StringResponse OnGameJoin(JoinGameCommand && cmd,
                               unsigned version,
                               bool keep_alive);
-    [[nodiscard]] StringResponse OnGamePlayers([[maybe_unused]] std::string_view body,
-                                               std::string_view authorization,
-                                               unsigned version,
-                                               bool keep_alive) const;
-    [[nodiscard]] StringResponse OnGamePlayer(std::string_view target,
-                                              std::string_view content_type,
-                                              std::string_view body,
-                                              std::string_view authorization,
-                                              unsigned version,
-                                              bool keep_alive) const;
-    [[nodiscard]] StringResponse OnGameTick(std::string_view content_type,
-                                            std::string_view body,
+    StringResponse OnGameJoinBatch(JoinGameBatchCommand && cmd,
+                                   unsigned version,
+                                   bool keep_alive);
+    [[nodiscard]] ApiResult<StringResponse> OnGamePlayers(const GamePlayersCommand & cmd,
+                                                          unsigned version,
+                                                          bool keep_alive) const;
+    [[nodiscard]] ApiResult<StringResponse> OnGameState(const GameStateCommand & cmd,
+                                                        unsigned version,
+                                                        bool keep_alive) const;
+    [[nodiscard]] std::optional<StringResponse> OnGameRecords(GameRecordsCommand && cmd,
+                                                              unsigned version,
+                                                              bool keep_alive,
+                                                              const ResponseSender & sender) const;
+    [[nodiscard]] StringResponse OnGameTick(const GameTickCommand & cmd,
                                             unsigned version,
                                             bool keep_alive) const;
-    [[nodiscard]] StringResponse OnGameState(std::string_view authorization,
-                                             unsigned version,
-                                             bool keep_alive) const;
-    [[nodiscard]] StringResponse OnGameRecords(std::string_view authorization,
-                                               std::string_view body,
-                                               unsigned version,
-                                               bool keep_alive) const;
-    [[nodiscard]] StringResponse OnCmdMaps(unsigned version,
-                                           bool keep_alive) const;
-    [[nodiscard]] StringResponse OnCmdFetchMap(std::string_view mapName,
-                                               unsigned version,
-                                               bool keep_alive) const;
-private:
-    [[nodiscard]] model::Player &FindPlayerByToken(std::string_view authorization,
-                                                   unsigned version,
-                                                   bool keep_alive) const;
 
-    static json::value ParseJson(std::string_view content_type,
-                                 std::string_view body,
-                                 unsigned version,
-                                 bool keep_alive);
-    static void ThrowMethodNotAllowed(unsigned version,
-                                      bool keep_alive,
-                                      std::string_view message,
-                                      std::string_view allow,
-                                      std::string_view code="invalidMethod");
-    static void ThrowPostOnlyExpected(unsigned version,
-                                      bool keep_alive);
-    static void ThrowGetHeadOnlyExpected(unsigned version,
-                                         bool keep_alive);
-    static void ThrowInvalidArgument(unsigned version,
-                                     bool keep_alive,
-                                     std::string_view message);
-    static void ThrowBadRequest(unsigned version,
-                                bool keep_alive,
-                                std::string_view message,
-                                std::string_view code="badRequest");
-    static void ThrowNotFound(unsigned version,
-                              bool keep_alive,
-                              std::string_view message,
-                              std::string_view code="notFound");
+    [[nodiscard]] ApiResult<model::Player *> FindPlayerByToken(const model::Token & token) const;
+    static ApiResult<model::Token> ParseAuthToken(std::string_view authorization);
+
+    static ApiResult<json::value> ParseJson(std::string_view content_type,
+                                            std::string_view body);
 
 private:
 
     ApplicationPtr app_;
-    db::ConnectionPool * connection_pool_ = nullptr;
+    app::LoadController & load_controller_;
 };
 
-}
\ No newline at end of file
+}
@@ -1,51 +1,119 @@
 #include "app.h"
 #include "game_db.h"
 
+#include <algorithm>
+
 
 namespace app
 {
 
-Application::Application(model::Game &game, db::ConnectionPool * connection_pool)
+Application::Application(model::Game &game, db::RecordsStorage * records_storage)
            : game_(game)
-           , connection_pool_(connection_pool)
+           , records_storage_(records_storage)
 {
-    if (connection_pool) {
-        {
-            auto conn_wrp = connection_pool->GetConnection();
-            db::CreateGameTable(*conn_wrp);
-        }
-
-        connection_pool->PrepareQuery(db::TAG_SELECT_RECORDS, db::QUERY_SELECT_RECORDS);
-        connection_pool->PrepareQuery(db::TAG_INSERT_PLAYER, db::QUERY_INSERT_PLAYER);
-    }
+    // Note: leaderboard top is read once, then kept up to date by retirements
+    if (records_storage)
+        records_cache_.Load(records_storage->LoadTop(records_cache_.GetDepth()));
 }
 
 void Application::ProcessGameTick(int64_t elapsedMs)
 {
-    auto retired_players = game_.Think(elapsedMs);
+    BeginGameTick(elapsedMs);
+    StepGameTick(model::TimePoint::max());
+}
 
-    if (!retired_players.empty()) {
-        if (connection_pool_) {
-            auto conn_wrp = connection_pool_->GetConnection();
-            for (const model::Token * token : retired_players) {
-                if (auto p = game_.FindPlayerByToken(*token); p) {
+void Application::BeginGameTick(int64_t elapsedMs)
+{
+    ApplyPlayerCommands();
 
-                    db::InertRetiredPlayer(*conn_wrp,
-                                           p->GetName(),
-                                           p->GetDog()->GetScore(),
-                                           p->GetPlayingTimeMs());
+    game_.BeginTick(elapsedMs);
+}
 
-                    game_.RemovePlayerByToken(*token);
-                }
-            }
-        } else {
+bool Application::StepGameTick(model::TimePoint deadline)
+{
+    if (!snapshots_.IsPublishing()) {
+        if (!game_.StepTick(deadline))
+            return false;
+
+        auto retired_players = game_.TakeRetiredPlayers();
+
+        if (!retired_players.empty()) {
             for (const model::Token * token : retired_players) {
                 if (auto p = game_.FindPlayerByToken(*token); p) {
+                    db::RecordItem item;
+                    item.id           = db::NewRecordId();
+                    item.name         = p->GetName();
+                    item.score        = p->GetDog()->GetScore();
+                    item.play_time_ms = p->GetPlayingTimeMs();
+
+                    if (records_storage_)
+                        records_storage_->InsertRecord(item);
+
+                    records_cache_.Insert(item);
+
                     game_.RemovePlayerByToken(*token);
                 }
             }
         }
+
+        // Note: readers on other threads see the new state only when the whole table is built
+        snapshots_.BeginPublishAll(game_.GetAwakeSessions());
+    }
+
+    // Note: serialization is the last phase of the tick and runs within the same slice budget
+    return snapshots_.PublishStep(deadline);
+}
+
+model::Player * Application::JoinGame(std::string_view user_name, model::Map & map)
+{
+    auto pPlayer = game_.Join(user_name, map);
+
+    // Note: a half-done tick is not published, the end of the tick publishes this session as well
+    if (!game_.IsTickRunning())
+        snapshots_.Publish(pPlayer->GetGameSession());
+
+    return pPlayer;
+}
+
+std::vector<model::Player *> Application::JoinGame(const std::vector<std::string> & user_names, model::Map & map)
+{
+    auto players = game_.JoinMany(user_names, map);
+    if (game_.IsTickRunning())
+        return players;
+
+    // Note: a batch lands in a few shards, each of them is published once
+    std::vector<const model::GameSession *> sessions;
+    for (const model::Player * p : players) {
+        if (std::ranges::find(sessions, &p->GetGameSession()) == sessions.end())
+            sessions.push_back(&p->GetGameSession());
     }
+
+    for (const model::GameSession * session : sessions)
+        snapshots_.Publish(*session);
+
+    return players;
+}
+
+void Application::ApplyPlayerCommands()
+{
+    commands_.Drain([this](PlayerCommand && cmd) {
+        // Note: the player may have left since the command was accepted
+        if (auto p = game_.FindPlayerByToken(cmd.token); p) {
+            float fSpeed = game_.GetDefaultDogSpeed();
+            if (auto speed = p->GetAssignedMap().GetDogSpeed(); speed)
+                fSpeed = *speed;
+
+            p->SetDirection(cmd.move, fSpeed);
+        }
+    });
+}
+
+void Application::FetchRecords(const db::RecordsQuery & query, db::RecordsHandler handler) const
+{
+    if (records_storage_)
+        records_storage_->FetchRecords(query, std::move(handler));
+    else
+        handler({});
 }
 
 }
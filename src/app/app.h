@@ -1,30 +1,56 @@
 #pragma once
 
 #include "../lib/model.h"
-#include "connection_pool.h"
+#include "../lib/mpsc_queue.h"
+#include "records_storage.h"
+#include "records_cache.h"
+#include "session_snapshots.h"
 
 
 namespace app
 {
 
+// Player input accepted off the strand, applied at the start of the next tick
+struct PlayerCommand
+{
+    model::Token token;
+    std::string move;
+};
+
+
 class Application
 {
 public:
 
-    Application(model::Game & game, db::ConnectionPool * connection_pool);
+    Application(model::Game & game, db::RecordsStorage * records_storage);
 
     [[nodiscard]] model::Map * FindMap(const model::Map::Id & id) const noexcept {
         return game_.FindMap(id);
     }
 
-    model::Player * JoinGame(std::string_view user_name, model::Map & map) {
-        return game_.Join(user_name, map);
-    }
+    // Snapshot of the session is republished, so the new player can read it right away
+    model::Player * JoinGame(std::string_view user_name, model::Map & map);
+    std::vector<model::Player *> JoinGame(const std::vector<std::string> & user_names, model::Map & map);
 
     [[nodiscard]] model::Player * FindPlayerByToken(const model::Token & t) const noexcept {
         return game_.FindPlayerByToken(t);
     }
 
+    // Thread safe
+    [[nodiscard]] std::optional<model::PlayerRoute> FindPlayerRoute(const model::Token & t) const {
+        return game_.FindPlayerRoute(t);
+    }
+
+    // Thread safe, state of the session published by the last tick
+    [[nodiscard]] SessionSnapshotPtr FindSessionSnapshot(model::GameSession::Id id) const {
+        return snapshots_.Find(id);
+    }
+
+    // Thread safe, the move is applied by the next game tick
+    void PostPlayerCommand(PlayerCommand && cmd) {
+        commands_.Push(std::move(cmd));
+    }
+
     void ForEachPlayerOnMap(const model::Map::Id & mapId, const model::PlayerVisitor & pv) const {
         game_.ForEachPlayerOnMap(mapId, pv);
     }
@@ -43,10 +69,33 @@ public:
 
     void ProcessGameTick(int64_t elapsedMs);
 
+    // Tick split into slices: BeginGameTick, then StepGameTick until it returns true.
+    // Only joins and snapshot reads may run between the slices
+    void BeginGameTick(int64_t elapsedMs);
+    bool StepGameTick(model::TimePoint deadline);
+
+    // Applies queued player commands, called at the start of a tick
+    void ApplyPlayerCommands();
+
+    // Returns std::nullopt if page is deeper than the cached part of leaderboard
+    [[nodiscard]] std::optional<db::RecordItems> GetCachedRecords(const db::RecordsQuery & query) const {
+        return records_cache_.GetPage(query);
+    }
+
+    // Handler is called on the API strand when the query completes
+    void FetchRecords(const db::RecordsQuery & query, db::RecordsHandler handler) const;
+
+    [[nodiscard]] uint64_t GetRecordsVersion() const noexcept {
+        return records_cache_.GetVersion();
+    }
+
 private:
 
     model::Game & game_;
-    db::ConnectionPool * connection_pool_ = nullptr;
+    db::RecordsStorage * records_storage_ = nullptr;
+    db::RecordsCache records_cache_;
+    util::MpscQueue<PlayerCommand> commands_;
+    SessionSnapshots snapshots_;
 
 };
 
@@ -0,0 +1,342 @@
+#include "async_connection_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/json.hpp>
+
+#include <libpq-fe.h>
+
+#include "logging.h"
+
+using namespace std::literals;
+
+
+namespace db
+{
+
+static void LogError(std::string_view where, std::string_view text)
+{
+    boost::json::object msg;
+    msg["text"]  = text;
+    msg["where"] = where;
+
+    BOOST_LOG_TRIVIAL(info) << boost::log::add_value(additional_data, msg)
+                            << "database error"sv;
+}
+
+class AsyncConnectionPool::Connection
+{
+public:
+
+    using DoneHandler = std::function<void(bool ok, Rows && rows)>;
+
+    Connection(Strand & strand, const std::string & url)
+        : conn_(PQconnectdb(url.c_str()))
+        , socket_(strand)
+        , retry_timer_(strand)
+    {
+        if (PQstatus(conn_) != CONNECTION_OK) {
+            std::string err = PQerrorMessage(conn_);
+            PQfinish(conn_);
+            throw std::runtime_error("Failed to connect database: "s + err);
+        }
+
+        socket_.assign(PQsocket(conn_));
+    }
+
+    ~Connection() {
+        // Note: socket is owned by libpq, PQfinish closes it
+        socket_.release();
+        PQfinish(conn_);
+    }
+
+    void Prepare(const std::string & tag, const std::string & query) {
+        PrepareStatement(tag, query);
+        prepared_.emplace_back(tag, query);
+    }
+
+    // Note: true after a transport failure, the server may have dropped the connection
+    // or left results of the query pending, so it cannot take another query as is
+    [[nodiscard]] bool IsBroken() const noexcept {
+        return broken_;
+    }
+
+    // Reconnects without blocking and prepares the statements again, retrying with backoff
+    // until the server is back. ready is called on the strand once the connection is usable
+    void Reconnect(std::function<void()> ready) {
+        ready_ = std::move(ready);
+
+        // Note: the descriptor is closed by libpq and may change on reconnect
+        socket_.release();
+        if (!PQresetStart(conn_))
+            return OnReconnectFailed();
+
+        // Note: right after PQresetStart libpq waits for the socket to become writable
+        PollReset(PGRES_POLLING_WRITING);
+    }
+
+    void Exec(const std::string & tag, const Params & params, DoneHandler done) {
+        done_ = std::move(done);
+        rows_.clear();
+        ok_ = true;
+
+        // Note: queries are prepared in blocking mode at startup, everything after is non-blocking
+        PQsetnonblocking(conn_, 1);
+
+        std::vector<const char *> values;
+        values.reserve(params.size());
+        for (const auto & p : params)
+            values.push_back(p.c_str());
+
+        // Note: libpq copies parameters to its output buffer, they may be freed after the call
+        if (!PQsendQueryPrepared(conn_, tag.c_str(), static_cast<int>(values.size()), values.data(),
+                                 nullptr, nullptr, 0)) {
+            LogError("send query"sv, PQerrorMessage(conn_));
+            return Fail();
+        }
+
+        Flush();
+    }
+
+private:
+
+    void PrepareStatement(const std::string & tag, const std::string & query) {
+        PGresult * res = PQprepare(conn_, tag.c_str(), query.c_str(), 0, nullptr);
+        const bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+        std::string err = ok ? ""s : PQresultErrorMessage(res);
+        PQclear(res);
+
+        if (!ok)
+            throw std::runtime_error("Failed to prepare query "s + tag + ": "s + err);
+    }
+
+    void Flush() {
+        if (int res = PQflush(conn_); res < 0)
+            Fail();
+        else if (res > 0) {
+            socket_.async_wait(asio::posix::stream_descriptor::wait_write, [this](const auto & ec) {
+                if (ec)
+                    Fail();
+                else
+                    Flush();
+            });
+        }
+        else
+            WaitResult();
+    }
+
+    void WaitResult() {
+        socket_.async_wait(asio::posix::stream_descriptor::wait_read, [this](const auto & ec) {
+            if (ec || !PQconsumeInput(conn_)) {
+                LogError("read result"sv, PQerrorMessage(conn_));
+                Fail();
+            }
+            else
+                CollectResults();
+        });
+    }
+
+    void CollectResults() {
+        // Note: PQgetResult blocks while libpq is busy, so check before every call
+        while (!PQisBusy(conn_)) {
+            PGresult * res = PQgetResult(conn_);
+            if (!res)
+                return Finish(ok_);
+
+            if (auto status = PQresultStatus(res); status == PGRES_TUPLES_OK) {
+                const int numRows = PQntuples(res);
+                const int numFields = PQnfields(res);
+
+                rows_.reserve(rows_.size() + static_cast<size_t>(numRows));
+                for (int r = 0; r < numRows; ++r) {
+                    Row & row = rows_.emplace_back();
+                    row.reserve(static_cast<size_t>(numFields));
+                    for (int f = 0; f < numFields; ++f)
+                        row.emplace_back(PQgetvalue(res, r, f), static_cast<size_t>(PQgetlength(res, r, f)));
+                }
+            }
+            else if (status != PGRES_COMMAND_OK) {
+                LogError("query"sv, PQresultErrorMessage(res));
+                ok_ = false;
+            }
+
+            PQclear(res);
+        }
+
+        WaitResult();
+    }
+
+    void Finish(bool ok) {
+        auto done = std::move(done_);
+        done(ok, std::move(rows_));
+    }
+
+    void Fail() {
+        broken_ = true;
+        Finish(false);
+    }
+
+    void PollReset(PostgresPollingStatusType status) {
+        if (status == PGRES_POLLING_OK) {
+            PQsetnonblocking(conn_, 1);
+            return PrepareNext(0);
+        }
+        if (status == PGRES_POLLING_FAILED || PQsocket(conn_) < 0)
+            return OnReconnectFailed();
+
+        if (!socket_.is_open())
+            socket_.assign(PQsocket(conn_));
+        else if (socket_.native_handle() != PQsocket(conn_)) {
+            socket_.release();
+            socket_.assign(PQsocket(conn_));
+        }
+
+        const auto wait = status == PGRES_POLLING_READING ? asio::posix::stream_descriptor::wait_read
+                                                          : asio::posix::stream_descriptor::wait_write;
+        socket_.async_wait(wait, [this](const auto & ec) {
+            if (ec)
+                OnReconnectFailed();
+            else
+                PollReset(PQresetPoll(conn_));
+        });
+    }
+
+    // Statements are prepared one by one through the same send/flush/wait loop as queries
+    void PrepareNext(size_t index) {
+        if (index == prepared_.size()) {
+            broken_ = false;
+            backoff_ = MIN_BACKOFF;
+            auto ready = std::move(ready_);
+            return ready();
+        }
+
+        done_ = [this, index](bool ok, Rows &&) {
+            if (ok)
+                PrepareNext(index + 1);
+            else
+                OnReconnectFailed();
+        };
+        rows_.clear();
+        ok_ = true;
+
+        const auto & [tag, query] = prepared_[index];
+        if (!PQsendPrepare(conn_, tag.c_str(), query.c_str(), 0, nullptr)) {
+            LogError("prepare query"sv, PQerrorMessage(conn_));
+            return OnReconnectFailed();
+        }
+
+        Flush();
+    }
+
+    void OnReconnectFailed() {
+        broken_ = true;
+        LogError("reconnect"sv, PQerrorMessage(conn_));
+
+        retry_timer_.expires_after(backoff_);
+        retry_timer_.async_wait([this](const auto & ec) {
+            if (!ec)
+                Reconnect(std::move(ready_));
+        });
+
+        backoff_ = std::min(backoff_ * 2, MAX_BACKOFF);
+    }
+
+
+    // Note: the first retry is quick, a server which stays down is polled rarely
+    static constexpr std::chrono::milliseconds MIN_BACKOFF{100};
+    static constexpr std::chrono::milliseconds MAX_BACKOFF{10000};
+
+    pg_conn * conn_ = nullptr;
+    asio::posix::stream_descriptor socket_;
+    DoneHandler done_;
+    Rows rows_;
+    bool ok_ = true;
+    bool broken_ = false;
+    std::vector<std::pair<std::string, std::string> > prepared_;
+    std::function<void()> ready_;
+    asio::steady_timer retry_timer_;
+    std::chrono::milliseconds backoff_ = MIN_BACKOFF;
+};
+
+
+AsyncConnectionPool::AsyncConnectionPool(asio::io_context & ioc,
+                                         const std::string & url,
+                                         size_t capacity,
+                                         Executor completion_executor)
+                   : strand_(asio::make_strand(ioc))
+                   , completion_executor_(std::move(completion_executor))
+{
+    connections_.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        connections_.push_back(std::make_unique<Connection>(strand_, url));
+        idle_.push_back(connections_.back().get());
+    }
+}
+
+AsyncConnectionPool::~AsyncConnectionPool() = default;
+
+void AsyncConnectionPool::PrepareQuery(const std::string & tag, const std::string & query)
+{
+    for (const auto & c : connections_)
+        c->Prepare(tag, query);
+}
+
+void AsyncConnectionPool::ExecPrepared(std::string tag, Params params, Handler handler)
+{
+    asio::dispatch(strand_, [this, q = Query{std::move(tag), std::move(params), std::move(handler)}]() mutable {
+        pending_.push_back(std::move(q));
+        StartNext();
+    });
+}
+
+void AsyncConnectionPool::StartNext()
+{
+    // Note: while every connection is reconnecting, queries fail at once instead of waiting for the server
+    if (reconnecting_ == connections_.size()) {
+        for (auto & q : pending_)
+            asio::post(completion_executor_, [handler = std::move(q.handler)]() mutable {
+                handler(false, {});
+            });
+        pending_.clear();
+    }
+
+    while (!idle_.empty() && !pending_.empty()) {
+        Connection * c = idle_.back();
+        idle_.pop_back();
+
+        auto q = std::move(pending_.front());
+        pending_.pop_front();
+
+        c->Exec(q.tag, q.params, [this, c, handler = std::move(q.handler)](bool ok, Rows && rows) mutable {
+            OnQueryDone(*c, handler, ok, std::move(rows));
+        });
+    }
+}
+
+void AsyncConnectionPool::OnQueryDone(Connection & connection, Handler & handler, bool ok, Rows && rows)
+{
+    asio::post(completion_executor_, [handler = std::move(handler), ok, rows = std::move(rows)]() mutable {
+        handler(ok, std::move(rows));
+    });
+
+    // Note: a broken connection would fail every later query, it stays out of idle_ until reconnected
+    if (connection.IsBroken()) {
+        ++reconnecting_;
+        connection.Reconnect([this, &connection] {
+            --reconnecting_;
+            idle_.push_back(&connection);
+            StartNext();
+        });
+    }
+    else
+        idle_.push_back(&connection);
+
+    StartNext();
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+struct pg_conn;
+
+
+namespace db
+{
+namespace asio = boost::asio;
+
+/*
+ *  Пул асинхронных соединений с PostgreSQL.
+ *  Сокеты libpq зарегистрированы в io_context, поэтому запрос не блокирует поток:
+ *  ожидание ответа сервера - это async_wait на сокете соединения.
+ *  Если все соединения заняты, запрос ждёт в очереди, медленный запрос задерживает только себя.
+ *  Обработчики результатов вызываются на completion_executor (strand API).
+ *  Соединение после сбоя переподключается асинхронно, с нарастающей паузой между попытками.
+ */
+class AsyncConnectionPool
+{
+public:
+    using Row      = std::vector<std::string>;
+    using Rows     = std::vector<Row>;
+    using Params   = std::vector<std::string>;
+    using Handler  = std::function<void(bool ok, Rows && rows)>;
+    using Executor = asio::any_io_executor;
+    using Strand   = asio::strand<asio::io_context::executor_type>;
+
+    AsyncConnectionPool(asio::io_context & ioc,
+                        const std::string & url,
+                        size_t capacity,
+                        Executor completion_executor);
+    ~AsyncConnectionPool();
+
+    AsyncConnectionPool(const AsyncConnectionPool &) = delete;
+    AsyncConnectionPool & operator=(const AsyncConnectionPool &) = delete;
+
+    // Blocking, must be called before io_context starts
+    void PrepareQuery(const std::string & tag, const std::string & query);
+
+    void ExecPrepared(std::string tag, Params params, Handler handler);
+
+private:
+
+    class Connection;
+
+    struct Query
+    {
+        std::string tag;
+        Params params;
+        Handler handler;
+    };
+
+    void StartNext();
+
+    void OnQueryDone(Connection & connection, Handler & handler, bool ok, Rows && rows);
+
+
+    Strand strand_;
+    Executor completion_executor_;
+    std::vector<std::unique_ptr<Connection> > connections_;
+    std::vector<Connection *> idle_;
+    std::deque<Query> pending_;
+    size_t reconnecting_ = 0;
+};
+
+}
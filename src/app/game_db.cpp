@@ -1,10 +1,13 @@
 #include "game_db.h"
+#include "async_connection_pool.h"
 
+#include <charconv>
 #include <iostream>
 #include <pqxx/pqxx>
 
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
 
 using namespace std::literals;
 // libpqxx использует zero-terminated символьные литералы вроде "abc"_zv;
@@ -13,13 +16,106 @@ using pqxx::operator"" _zv;
 namespace db
 {
 
+// Note: ordering (-score, play_time_ms, name, id) matches retired_players_keyset_idx,
+// so a page after a cursor is an index range scan regardless of its depth
 pqxx::zview TAG_SELECT_RECORDS = "sel_records_tag";
-pqxx::zview QUERY_SELECT_RECORDS = "SELECT name score play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT $1 OFFSET $2;";
+pqxx::zview QUERY_SELECT_RECORDS = "SELECT id, name, score, play_time_ms FROM retired_players "
+                                   "ORDER BY -score, play_time_ms, name, id LIMIT $1 OFFSET $2;";
+
+pqxx::zview TAG_SELECT_RECORDS_AFTER = "sel_records_after_tag";
+pqxx::zview QUERY_SELECT_RECORDS_AFTER = "SELECT id, name, score, play_time_ms FROM retired_players "
+                                         "WHERE (-score, play_time_ms, name, id) > (-$1::integer, $2::integer, $3::varchar, $4::uuid) "
+                                         "ORDER BY -score, play_time_ms, name, id LIMIT $5;";
 
 pqxx::zview TAG_INSERT_PLAYER = "ins_records_tag";
-pqxx::zview QUERY_INSERT_PLAYER = "INSERT INTO retired_players VALUES (DEFAULT, $1, $2, $3);";
+pqxx::zview QUERY_INSERT_PLAYER = "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ($1, $2, $3, $4);";
+
+
+std::string NewRecordId()
+{
+    thread_local boost::uuids::random_generator generator;
+    return boost::uuids::to_string(generator());
+}
+
+std::string EncodeRecordCursor(const RecordItem & item)
+{
+    constexpr std::string_view HEX = "0123456789abcdef"sv;
+
+    std::string raw = std::to_string(item.score) + ':' + std::to_string(item.play_time_ms) + ':' +
+                      item.id + ':' + item.name;
+
+    std::string ret;
+    ret.reserve(raw.size() * 2);
+    for (unsigned char c : raw) {
+        ret += HEX[c >> 4];
+        ret += HEX[c & 0x0F];
+    }
+
+    return ret;
+}
+
+std::optional<RecordItem> DecodeRecordCursor(std::string_view cursor)
+{
+    if (cursor.empty() || cursor.size() % 2 != 0)
+        return std::nullopt;
+
+    std::string raw;
+    raw.reserve(cursor.size() / 2);
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        unsigned value = 0;
+        if (auto [ptr, ec] = std::from_chars(cursor.data() + i, cursor.data() + i + 2, value, 16);
+            ec != std::errc() || ptr != cursor.data() + i + 2)
+            return std::nullopt;
+
+        raw += static_cast<char>(value);
+    }
+
+    // Note: score:play_time_ms:id:name, name may contain ':'
+    std::string_view sv = raw;
+    std::string_view parts[3];
+    for (auto & part : parts) {
+        auto pos = sv.find(':');
+        if (pos == std::string_view::npos)
+            return std::nullopt;
+
+        part = sv.substr(0, pos);
+        sv.remove_prefix(pos + 1);
+    }
+
+    RecordItem ret;
+    if (auto [ptr, ec] = std::from_chars(parts[0].data(), parts[0].data() + parts[0].size(), ret.score);
+        ec != std::errc() || ptr != parts[0].data() + parts[0].size())
+        return std::nullopt;
+
+    if (auto [ptr, ec] = std::from_chars(parts[1].data(), parts[1].data() + parts[1].size(), ret.play_time_ms);
+        ec != std::errc() || ptr != parts[1].data() + parts[1].size())
+        return std::nullopt;
+
+    ret.id   = parts[2];
+    ret.name = sv;
+
+    return ret;
+}
 
 
+static RecordItems ParseRecords(const pqxx::result & result)
+{
+    RecordItems retItems;
+    retItems.reserve(result.size());
+
+    for (const auto & row : result) {
+        RecordItem rec;
+        rec.id = row[0].as<std::string>();
+        rec.name = row[1].as<std::string>();
+        rec.score = row[2].as<int>();
+        rec.play_time_ms = row[3].as<int>();
+
+        retItems.push_back(std::move(rec));
+    }
+
+    return retItems;
+}
+
 bool CreateGameTable(pqxx::connection & connection)
 {
     bool bRet = false;
@@ -27,14 +123,26 @@ bool CreateGameTable(pqxx::connection & connection)
     try {
         pqxx::work w(connection);
 
+        // Note: bytewise collation for name keeps the order equal to the in-memory one
         w.exec("CREATE TABLE IF NOT EXISTS retired_players  ("
                "id UUID PRIMARY KEY, "
-               "name varchar(100) NOT NULL, "
+               "name varchar(100) COLLATE \"C\" NOT NULL, "
                "score integer NOT NULL, "
-               "play_time_ms integer NOT NULL;"_zv);
-
-        w.exec("CREATE INDEX IF NOT EXISTS retired_players_idx ON retired_players ("
-               "score DESC, play_time_ms, name);"_zv);
+               "play_time_ms integer NOT NULL);"_zv);
+
+        // Note: a table created before keeps its collation, it is migrated once; the check avoids
+        // rebuilding the indexes on name at every start
+        w.exec("DO $$ BEGIN "
+               "IF EXISTS (SELECT 1 FROM information_schema.columns "
+               "WHERE table_schema = current_schema() AND table_name = 'retired_players' "
+               "AND column_name = 'name' AND collation_name IS DISTINCT FROM 'C') THEN "
+               "ALTER TABLE retired_players ALTER COLUMN name TYPE varchar(100) COLLATE \"C\"; "
+               "END IF; END $$;"_zv);
+
+        // Covering index for keyset pagination, supersedes retired_players_idx
+        w.exec("DROP INDEX IF EXISTS retired_players_idx;"_zv);
+        w.exec("CREATE INDEX IF NOT EXISTS retired_players_keyset_idx ON retired_players ("
+               "(-score), play_time_ms, name, id) INCLUDE (score);"_zv);
 
         // Применяем все изменения
         w.commit();
@@ -48,50 +156,72 @@ bool CreateGameTable(pqxx::connection & connection)
     return bRet;
 }
 
-bool InertRetiredPlayer(pqxx::connection & connection, std::string_view name, int score, int64_t play_time_ms)
+RecordItems FetchRecords(pqxx::connection & connection, int start, int maxItems)
 {
-    bool bRet = false;
+    RecordItems retItems;
 
     try {
-        pqxx::work w(connection);
+        pqxx::read_transaction r(connection);
 
-        auto result = w.exec_prepared(db::TAG_INSERT_PLAYER, name, score, static_cast<int>(play_time_ms));
-        if (!result.empty())
-            bRet = true;
+        // Note: LIMIT $1 OFFSET $2
+        auto result = r.exec_prepared(db::TAG_SELECT_RECORDS, maxItems, start);
+        retItems = ParseRecords(result);
     }
     catch (const std::exception & e) {
         std::cout << e.what() << std::endl;
     }
 
-    return bRet;
+    return retItems;
 }
 
-RecordItems FetchRecords(pqxx::connection & connection, int start, int maxItems)
+void AsyncFetchRecords(AsyncConnectionPool & pool, const RecordsQuery & query, RecordsHandler handler)
 {
-    RecordItems retItems;
+    std::string tag;
+    AsyncConnectionPool::Params params;
+
+    if (query.after) {
+        tag = TAG_SELECT_RECORDS_AFTER;
+        params = { std::to_string(query.after->score),
+                   std::to_string(query.after->play_time_ms),
+                   query.after->name,
+                   query.after->id,
+                   std::to_string(query.maxItems) };
+    }
+    else {
+        tag = TAG_SELECT_RECORDS;
+        params = { std::to_string(query.maxItems), std::to_string(query.start) };
+    }
 
-    try {
-        pqxx::read_transaction r(connection);
+    pool.ExecPrepared(std::move(tag), std::move(params),
+                      [handler = std::move(handler)](bool ok, AsyncConnectionPool::Rows && rows) {
+        RecordItems retItems;
 
-        auto result = r.exec_prepared(db::TAG_SELECT_RECORDS, start, maxItems);
-        for (const auto & row : result) {
-            const auto & name = row[0];
-            const auto & score = row[1];
-            const auto & play_time_ms = row[2];
+        if (ok) {
+            retItems.reserve(rows.size());
 
-            RecordItem rec;
-            rec.name = row[0].as<std::string_view>();
-            rec.score = row[1].as<int>();
-            rec.playtime = static_cast<float>(row[2].as<int>()) / 1000.0f;
+            for (auto & row : rows) {
+                RecordItem rec;
+                rec.id = std::move(row[0]);
+                rec.name = std::move(row[1]);
+                std::from_chars(row[2].data(), row[2].data() + row[2].size(), rec.score);
+                std::from_chars(row[3].data(), row[3].data() + row[3].size(), rec.play_time_ms);
 
-            retItems.push_back(rec);
+                retItems.push_back(std::move(rec));
+            }
         }
-    }
-    catch (const std::exception & e) {
-        std::cout << e.what() << std::endl;
-    }
 
-    return retItems;
+        handler(std::move(retItems));
+    });
+}
+
+void AsyncInsertRetiredPlayer(AsyncConnectionPool & pool, const RecordItem & item)
+{
+    pool.ExecPrepared(std::string(TAG_INSERT_PLAYER),
+                      { item.id, item.name, std::to_string(item.score), std::to_string(item.play_time_ms) },
+                      [id = item.id](bool ok, AsyncConnectionPool::Rows &&) {
+        if (!ok)
+            std::cout << "Failed to insert retired player " << id << std::endl;
+    });
 }
 
-}
\ No newline at end of file
+}
@@ -1,31 +1,57 @@
 #pragma once
 
+#include <functional>
+#include <optional>
 #include <pqxx/connection>
 
 namespace db
 {
+    class AsyncConnectionPool;
+
     constexpr size_t MAX_NUM_RECORD_ITEMS = 100;
     extern pqxx::zview TAG_SELECT_RECORDS;
     extern pqxx::zview QUERY_SELECT_RECORDS;
 
+    extern pqxx::zview TAG_SELECT_RECORDS_AFTER;
+    extern pqxx::zview QUERY_SELECT_RECORDS_AFTER;
+
     extern pqxx::zview TAG_INSERT_PLAYER;
     extern pqxx::zview QUERY_INSERT_PLAYER;
 
     struct RecordItem
     {
+        std::string id;
         std::string name;
-        int score;
-        float playtime;
+        int score = 0;
+        int64_t play_time_ms = 0;
     };
 
     using RecordItems = std::vector<RecordItem>;
 
-    bool CreateGameTable(pqxx::connection & connection);
+    // Leaderboard page: either start offset or keyset cursor (the last row of the previous page)
+    struct RecordsQuery
+    {
+        size_t start = 0;
+        std::optional<RecordItem> after = std::nullopt;
+        size_t maxItems = MAX_NUM_RECORD_ITEMS;
+    };
 
-    bool InertRetiredPlayer(pqxx::connection & connection, std::string_view name, int score, int64_t play_time_ms);
+    std::string NewRecordId();
 
+    // Opaque cursor built from (score, play_time_ms, name, id) of the row
+    std::string EncodeRecordCursor(const RecordItem & item);
+    std::optional<RecordItem> DecodeRecordCursor(std::string_view cursor);
+
+    bool CreateGameTable(pqxx::connection & connection);
+
+    // Blocking, used at startup to load the leaderboard top
     RecordItems FetchRecords(pqxx::connection & connection, int start, int maxItems);
 
+    // Non-blocking variants, handler is called on the completion executor of the pool
+    using RecordsHandler = std::function<void(RecordItems && items)>;
+
+    void AsyncFetchRecords(AsyncConnectionPool & pool, const RecordsQuery & query, RecordsHandler handler);
 
+    void AsyncInsertRetiredPlayer(AsyncConnectionPool & pool, const RecordItem & item);
 
 }
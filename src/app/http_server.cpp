@@ -45,14 +45,52 @@ void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t byte
         ReportError(ec, "read"sv);
     else
     {
-        HandleRequest(stream_.socket().remote_endpoint(), std::move(request_));
+        ++requests_;
+        auto cancel = std::make_shared<CancellationToken>();
+        WatchDisconnect(cancel);
+
+        HandleRequest(stream_.socket().remote_endpoint(), std::move(request_), std::move(cancel));
     }
 }
 
+void SessionBase::WatchDisconnect(CancellationTokenPtr cancel)
+{
+    // Note: nothing is read while the request is handled, so the socket turns readable when the client sends
+    // the next request, half-closes its side or the connection breaks. Only a broken connection drops the response
+    stream_.socket().async_wait(asio::ip::tcp::socket::wait_read,
+                                [self = GetSharedThis(), cancel = std::move(cancel), request = requests_](beast::error_code ec) {
+        // Note: the wait is cancelled once the response is written, a late wake-up belongs to an older request
+        if (ec == asio::error::operation_aborted || request != self->requests_)
+            return;
+
+        auto & socket = self->stream_.socket();
+        if (!ec) {
+            char byte;
+            socket.non_blocking(true, ec);
+            if (!ec)
+                socket.receive(asio::buffer(&byte, 1), asio::socket_base::message_peek, ec);
+
+            // Note: data is the next request, EOF is a half-close - the client still reads the response
+            if (ec != asio::error::connection_reset && ec != asio::error::broken_pipe)
+                return;
+        }
+
+        cancel->Cancel();
+
+        // Note: the response is dropped, so nothing else would end the session
+        beast::error_code close_ec;
+        socket.close(close_ec);
+    });
+}
+
 void SessionBase::OnWrite(bool close,
                           beast::error_code ec,
                           [[maybe_unused]] size_t bytes_written)
 {
+    // Note: the disconnect watch of the answered request must not race the next read over the same bytes
+    beast::error_code cancel_ec;
+    stream_.socket().cancel(cancel_ec);
+
     if (ec)
         ReportError(ec, "write"sv);
     else if (close)
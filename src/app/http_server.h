@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
@@ -13,6 +18,29 @@ namespace beast = boost::beast;
 namespace http  = beast::http;
 
 
+// Взводится сессией, когда клиент уже не прочитает ответ (соединение сброшено).
+// Сессия при этом сама закрывает соединение, обработчику остаётся не отправлять ответ.
+// Проверяется из любого потока
+class CancellationToken
+{
+public:
+
+    void Cancel() noexcept {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool IsCancelled() const noexcept {
+        return cancelled_.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    std::atomic<bool> cancelled_ = false;
+};
+
+using CancellationTokenPtr = std::shared_ptr<CancellationToken>;
+
+
 class SessionBase
 {
 public:
@@ -39,11 +67,15 @@ protected:
         // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
         auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
         auto self          = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, size_t bytes_written)
-                          {
-                              self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                          });
+
+        // Note: the response may come from the simulation thread, the stream is used only on its own strand
+        asio::dispatch(stream_.get_executor(), [safe_response, self] {
+            http::async_write(self->stream_, *safe_response,
+                              [safe_response, self](beast::error_code ec, size_t bytes_written)
+                              {
+                                  self->OnWrite(safe_response->need_eof(), ec, bytes_written);
+                              });
+        });
     }
 
 private:
@@ -57,7 +89,9 @@ private:
                   size_t             bytes_written);
     void Close   ();
 
-    virtual void HandleRequest (const asio::ip::tcp::endpoint & endpoint, HttpRequest && request) = 0;
+    void WatchDisconnect (CancellationTokenPtr cancel);
+
+    virtual void HandleRequest (const asio::ip::tcp::endpoint & endpoint, HttpRequest && request, CancellationTokenPtr cancel) = 0;
     virtual void ReportError (beast::error_code ec, std::string_view what) = 0;
 
     virtual SessionBasePtr GetSharedThis () = 0;
@@ -68,6 +102,8 @@ private:
     beast::tcp_stream   stream_;
     beast::flat_buffer  buffer_;
     HttpRequest         request_;
+    // Note: number of the request being handled, tells a stale disconnect watch from the current one
+    uint64_t            requests_ = 0;
 };
 
 
@@ -83,7 +119,7 @@ public:
 
 private:
 
-    void HandleRequest(const asio::ip::tcp::endpoint & endpoint, HttpRequest && request) override {
+    void HandleRequest(const asio::ip::tcp::endpoint & endpoint, HttpRequest && request, CancellationTokenPtr cancel) override {
         // Захватываем умный указатель на текущий объект Session в лямбде,чтобы продлить время жизни сессии до вызова лямбды.
         // Используется generic-лямбда функция, способная принять response произвольного типа
 
@@ -91,7 +127,7 @@ private:
             self->Write(std::forward<decltype(response)>(response));
         };
 
-        request_handler_(endpoint, std::move(request), std::move(fn));
+        request_handler_(endpoint, std::move(request), std::move(fn), std::move(cancel));
     }
 
     void ReportError (beast::error_code ec, std::string_view what) override {
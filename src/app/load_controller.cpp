@@ -0,0 +1,55 @@
+#include "load_controller.h"
+
+#include <algorithm>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+
+namespace app
+{
+
+namespace
+{
+constexpr double AVG_WEIGHT = 0.125;
+
+// Доля периода такта, занятая самим тактом
+constexpr double HIGH_DUTY = 0.8;
+constexpr double LOW_DUTY  = 0.5;
+}
+
+void LoadController::OnTick(Clock::duration tick_duration)
+{
+    ++tick_count_;
+
+    if (nominal_period_ <= 0ms)
+        return;
+
+    const double tick_us = duration_cast<duration<double, std::micro>>(tick_duration).count();
+    avg_tick_us_ += (tick_us - avg_tick_us_) * AVG_WEIGHT;
+
+    const double duty = avg_tick_us_ / static_cast<double>(duration_cast<microseconds>(tick_period_).count());
+    // Note: long queue means requests starve between ticks even if a tick itself fits the budget
+    const bool congested = GetBacklog() >= max_backlog_ / 2;
+    const auto max_period = GetMaxStep();
+
+    if (duty > HIGH_DUTY || congested) {
+        if (tick_period_ < max_period)
+            tick_period_ = std::min(max_period, tick_period_ + std::max<milliseconds>(tick_period_ / 4, 1ms));
+        else
+            overloaded_ = true;
+    }
+    else if (duty < LOW_DUTY) {
+        overloaded_ = false;
+
+        if (tick_period_ > nominal_period_)
+            tick_period_ = std::max(nominal_period_, tick_period_ - std::max<milliseconds>(tick_period_ / 8, 1ms));
+    }
+}
+
+seconds LoadController::GetRetryAfter() const noexcept
+{
+    return std::max<seconds>(ceil<seconds>(GetMaxStep()), 1s);
+}
+
+}   // namespace app
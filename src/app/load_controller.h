@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+namespace app
+{
+
+/*
+ *  Регулятор нагрузки на strand API.
+ *  Такт игры и запросы к API выполняются на одном strand, поэтому при долгом такте
+ *  растёт очередь запросов. Деградация идёт ступенями:
+ *    1. такт растягивается (до MAX_STRETCH периодов);
+ *    2. если не помогло, некритичные запросы (рекорды, список карт) получают 503.
+ *  OnTick вызывается только внутри strand API, признак перегрузки читается из любого потока.
+ */
+class LoadController
+{
+public:
+    using Clock        = std::chrono::steady_clock;
+    using milliseconds = std::chrono::milliseconds;
+
+    static constexpr int64_t MAX_STRETCH = 4;
+    static constexpr size_t  DEFAULT_MAX_BACKLOG = 256;
+
+    // tick_period == 0 - ticks come from the API, only backlog is watched
+    explicit LoadController(milliseconds tick_period, size_t max_backlog = DEFAULT_MAX_BACKLOG)
+        : nominal_period_(tick_period)
+        , tick_period_(tick_period)
+        , max_backlog_(max_backlog) {
+    }
+
+    LoadController(const LoadController &) = delete;
+    LoadController & operator=(const LoadController &) = delete;
+
+    // Called after every game tick with the time spent inside the tick
+    void OnTick(Clock::duration tick_duration);
+
+    // May be called from any thread
+    void OnRequestQueued() noexcept {
+        backlog_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OnRequestStarted() noexcept {
+        backlog_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] size_t GetBacklog() const noexcept {
+        return backlog_.load(std::memory_order_relaxed);
+    }
+
+    // Queued request was not run: its client has gone or its deadline has passed
+    void OnRequestDropped() noexcept {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t GetDroppedCount() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Stretched tick period, the ticker should use it from the next tick
+    [[nodiscard]] milliseconds GetTickPeriod() const noexcept {
+        return tick_period_;
+    }
+
+    // The longest time span simulated by one Game::Think call
+    [[nodiscard]] milliseconds GetMaxStep() const noexcept {
+        return nominal_period_ * MAX_STRETCH;
+    }
+
+    [[nodiscard]] uint64_t GetTickCount() const noexcept {
+        return tick_count_;
+    }
+
+    // Non-critical requests should be rejected. May be called from any thread
+    [[nodiscard]] bool IsOverloaded() const noexcept {
+        return overloaded_.load(std::memory_order_relaxed) || GetBacklog() >= max_backlog_;
+    }
+
+    // Value of Retry-After header for rejected requests
+    [[nodiscard]] std::chrono::seconds GetRetryAfter() const noexcept;
+
+private:
+
+    milliseconds nominal_period_;
+    milliseconds tick_period_;
+    size_t max_backlog_;
+
+    std::atomic<size_t> backlog_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    // Note: exponential moving average of tick duration, microseconds
+    double avg_tick_us_ = 0.0;
+    uint64_t tick_count_ = 0;
+    std::atomic<bool> overloaded_{false};
+};
+
+}   // namespace app
@@ -0,0 +1,198 @@
+#include "local_records_store.h"
+
+#include <charconv>
+#include <iostream>
+#include <optional>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+#include <boost/json.hpp>
+
+#include "logging.h"
+
+using namespace std::literals;
+
+
+namespace db
+{
+
+static std::string EscapeName(std::string_view name)
+{
+    std::string ret;
+    ret.reserve(name.size());
+
+    for (char c : name) {
+        switch (c) {
+        case '\\': ret += "\\\\"sv; break;
+        case '\t': ret += "\\t"sv;  break;
+        case '\n': ret += "\\n"sv;  break;
+        default:   ret += c;        break;
+        }
+    }
+
+    return ret;
+}
+
+static std::string UnescapeName(std::string_view name)
+{
+    std::string ret;
+    ret.reserve(name.size());
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] == '\\' && i + 1 < name.size()) {
+            switch (name[++i]) {
+            case 't': ret += '\t'; break;
+            case 'n': ret += '\n'; break;
+            default:  ret += name[i]; break;
+            }
+        }
+        else
+            ret += name[i];
+    }
+
+    return ret;
+}
+
+static std::optional<RecordItem> ParseRecordLine(std::string_view line)
+{
+    std::string_view fields[3];
+    for (auto & field : fields) {
+        auto pos = line.find('\t');
+        if (pos == std::string_view::npos)
+            return std::nullopt;
+
+        field = line.substr(0, pos);
+        line.remove_prefix(pos + 1);
+    }
+
+    RecordItem ret;
+    ret.id = fields[0];
+    ret.name = UnescapeName(line);
+
+    if (auto [ptr, ec] = std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), ret.score);
+        ec != std::errc() || ptr != fields[1].data() + fields[1].size())
+        return std::nullopt;
+
+    if (auto [ptr, ec] = std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), ret.play_time_ms);
+        ec != std::errc() || ptr != fields[2].data() + fields[2].size())
+        return std::nullopt;
+
+    return ret;
+}
+
+LocalRecordsStore::LocalRecordsStore(const std::filesystem::path & path, boost::asio::any_io_executor writer)
+                 : path_(path)
+                 , writer_(std::move(writer))
+{
+    std::optional<std::streamoff> tornAt;
+
+    if (std::ifstream file(path); file) {
+        std::string line;
+        size_t lineNo = 0;
+        std::streamoff lineStart = 0;
+
+        while (std::getline(file, line)) {
+            ++lineNo;
+
+            // Note: last line without '\n' is a record torn by crash, its name may be cut short
+            if (file.eof()) {
+                tornAt = lineStart;
+                std::cout << "Skip torn record at "sv << path << ':' << lineNo << std::endl;
+                break;
+            }
+
+            if (auto item = ParseRecordLine(line); item)
+                index_.insert(std::move(*item));
+            else
+                std::cout << "Skip malformed record at "sv << path << ':' << lineNo << std::endl;
+
+            lineStart = file.tellg();
+        }
+    }
+
+    // Note: the torn tail is cut off, otherwise the next record would complete it into a valid line
+    if (tornAt)
+        std::filesystem::resize_file(path, static_cast<uintmax_t>(*tornAt));
+
+    log_.open(path, std::ios::out | std::ios::app);
+    if (!log_)
+        throw std::runtime_error("Failed to open records file "s + path.string());
+}
+
+LocalRecordsStore::~LocalRecordsStore()
+{
+    WritePending();
+}
+
+void LocalRecordsStore::InsertRecord(const RecordItem & item)
+{
+    std::string line = item.id + '\t' + std::to_string(item.score) + '\t' + std::to_string(item.play_time_ms) +
+                       '\t' + EscapeName(item.name) + '\n';
+
+    bool post = false;
+    {
+        std::lock_guard lock(pending_mutex_);
+        pending_ += line;
+        ++pending_records_;
+        post = !std::exchange(write_posted_, true);
+    }
+
+    if (post)
+        boost::asio::post(writer_, [this] { WritePending(); });
+
+    index_.insert(item);
+}
+
+void LocalRecordsStore::WritePending()
+{
+    for (;;) {
+        std::string lines;
+        size_t records = 0;
+        {
+            std::lock_guard lock(pending_mutex_);
+            if (pending_.empty()) {
+                write_posted_ = false;
+                return;
+            }
+
+            lines.swap(pending_);
+            records = std::exchange(pending_records_, 0);
+        }
+
+        log_.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+        log_.flush();
+
+        if (!log_) {
+            boost::json::object msg;
+            msg["file"]         = path_.string();
+            msg["lost_records"] = records;
+
+            BOOST_LOG_TRIVIAL(info) << boost::log::add_value(additional_data, msg)
+                                    << "failed to write records"sv;
+
+            // Note: the stream would refuse every later write, the next batch tries again
+            log_.clear();
+        }
+    }
+}
+
+RecordItems LocalRecordsStore::GetPage(const RecordsQuery & query) const
+{
+    RecordItems ret;
+
+    // Note: cursor lookup is O(log n), offset paging walks the tree
+    auto it = index_.begin();
+    if (query.after)
+        it = index_.upper_bound(*query.after);
+    else if (query.start < index_.size())
+        std::advance(it, static_cast<ptrdiff_t>(query.start));
+    else
+        it = index_.end();
+
+    for (; it != index_.end() && ret.size() < query.maxItems; ++it)
+        ret.push_back(*it);
+
+    return ret;
+}
+
+}
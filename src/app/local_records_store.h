@@ -0,0 +1,83 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include "records_storage.h"
+#include "records_cache.h"
+
+
+namespace db
+{
+
+/*
+ *  Встроенное хранилище рекордов для запуска без PostgreSQL (DB_URL не задан).
+ *  Записи дописываются в конец файла-журнала, при старте журнал читается целиком
+ *  в упорядоченный индекс, поэтому таблица рекордов отдаётся из памяти.
+ *
+ *  Формат журнала: по строке на запись "id\tscore\tplay_time_ms\tname",
+ *  символы '\\', '\t', '\n' в имени экранируются.
+ *
+ *  Запись в файл выполняется на writer, а не на strand API: строки копятся в буфере
+ *  и дописываются одной пачкой, пока предыдущая запись не закончилась.
+ */
+class LocalRecordsStore : public RecordsStorage
+{
+public:
+
+    LocalRecordsStore(const std::filesystem::path & path, boost::asio::any_io_executor writer);
+
+    // Writes the lines which are still buffered
+    ~LocalRecordsStore() override;
+
+    LocalRecordsStore(const LocalRecordsStore &) = delete;
+    LocalRecordsStore & operator=(const LocalRecordsStore &) = delete;
+
+    [[nodiscard]] RecordItems LoadTop(size_t maxItems) override {
+        return GetPage({ .start = 0, .maxItems = maxItems });
+    }
+
+    void FetchRecords(const RecordsQuery & query, RecordsHandler handler) override {
+        handler(GetPage(query));
+    }
+
+    void InsertRecord(const RecordItem & item) override;
+
+    [[nodiscard]] RecordItems GetPage(const RecordsQuery & query) const;
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return index_.size();
+    }
+
+private:
+
+    struct RecordLess
+    {
+        bool operator()(const RecordItem & lhs, const RecordItem & rhs) const noexcept {
+            return RecordsCache::Less(lhs, rhs);
+        }
+    };
+
+    using Index = std::multiset<RecordItem, RecordLess>;
+
+    // Runs on writer, one call at a time: the next one is posted only after this one has drained the buffer
+    void WritePending();
+
+
+    std::filesystem::path path_;
+    std::ofstream log_;
+    Index index_;
+
+    boost::asio::any_io_executor writer_;
+    std::mutex pending_mutex_;
+    std::string pending_;
+    size_t pending_records_ = 0;
+    bool write_posted_ = false;
+};
+
+}
@@ -66,17 +66,18 @@ namespace server_logging
         template <typename Body, typename Allocator, typename Send>
         void operator()(const asio::ip::tcp::endpoint & endpoint,
                         http::request<Body, http::basic_fields<Allocator>>&& req,
-                        Send&& send)
+                        Send&& send,
+                        http_server::CancellationTokenPtr cancel)
         {
             LogRequest(endpoint, req);
 
-            auto fnOnResponse = [this, &endpoint, tpBegin = ClockT::now(), snd = std::move(send)](auto&& response) {
+            auto fnOnResponse = [this, endpoint, tpBegin = ClockT::now(), snd = std::move(send)](auto&& response) {
                 LogResponse(endpoint, tpBegin, response);
 
                 snd(std::move(response));
             };
 
-            (*decorated_)(endpoint, std::move(req), std::move(fnOnResponse));
+            (*decorated_)(endpoint, std::move(req), std::move(fnOnResponse), std::move(cancel));
         }
 
         void ReportError (beast::error_code ec, std::string_view where)
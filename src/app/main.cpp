@@ -2,6 +2,7 @@
 #include <thread>
 #include <chrono>
 
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/program_options.hpp>
@@ -12,6 +13,11 @@
 #include "logging.h"
 #include "ticker.h"
 #include "connection_pool.h"
+#include "async_connection_pool.h"
+#include "local_records_store.h"
+#include "load_controller.h"
+#include "thread_tuning.h"
+#include "tick_slicer.h"
 
 
 using namespace std::literals;
@@ -51,6 +57,14 @@ struct Args
     int tick_period = 0;
     std::string config_file;
     std::string www_root;
+    std::string records_file = "game_records.log";
+    std::string tick_policy = "coalesce";
+    int tick_slice_us = 2000;
+    unsigned sim_threads = 1;
+    int request_timeout_ms = static_cast<int>(http_handler::RequestHandler::DEFAULT_REQUEST_TIMEOUT.count());
+    std::optional<uint64_t> random_seed;
+    std::optional<unsigned> sim_cpu;
+    bool sim_realtime = false;
     bool randomize_spawn_points = false;
 };
 
@@ -60,6 +74,8 @@ struct Args
     namespace po = boost::program_options;
 
     Args args;
+    uint64_t random_seed = 0;
+    unsigned sim_cpu = 0;
     po::options_description desc("All options"s);
     desc.add_options()
         ("help,h", "produce help message")
@@ -67,6 +83,14 @@ struct Args
         ("config-file,c",          po::value(&args.config_file)->value_name("file"),         "set config file path")
         ("www-root,w",             po::value(&args.www_root)->value_name("dir"),             "set static files root")
         ("randomize-spawn-points", po::value(&args.randomize_spawn_points)->value_name(" "), "spawn dogs at random positions")
+        ("records-file",           po::value(&args.records_file)->value_name("file"),        "set records log path (used without DB_URL)")
+        ("random-seed",            po::value(&random_seed)->value_name("seed"),              "seed for reproducible spawns and loot")
+        ("tick-policy",            po::value(&args.tick_policy)->value_name("policy"),       "missed ticks handling: catch-up, coalesce or skip")
+        ("tick-slice",             po::value(&args.tick_slice_us)->value_name("microseconds"), "time budget of one tick slice, 0 - ticks are not sliced")
+        ("sim-cpu",                po::value(&sim_cpu)->value_name("cpu"),                   "pin the simulation thread to a CPU")
+        ("sim-realtime",           po::bool_switch(&args.sim_realtime),                      "run the simulation thread with real-time priority")
+        ("request-timeout",        po::value(&args.request_timeout_ms)->value_name("milliseconds"), "longest wait of an API request for the game strand")
+        ("sim-threads",            po::value(&args.sim_threads)->value_name("n"),            "threads simulating one big session, the simulation thread included")
         ;
 
     po::variables_map vm;
@@ -79,6 +103,12 @@ struct Args
         return std::nullopt;
     }
 
+    if (vm.contains("random-seed"s))
+        args.random_seed = random_seed;
+
+    if (vm.contains("sim-cpu"s))
+        args.sim_cpu = sim_cpu;
+
     if (!vm.contains("config-file"s)) {
         throw std::runtime_error("Server config file missed"s);
     }
@@ -91,6 +121,23 @@ struct Args
 }
 
 
+[[nodiscard]] model::Ticker::MissedTickPolicy ParseTickPolicy(std::string_view policy)
+{
+    using Policy = model::Ticker::MissedTickPolicy;
+
+    if (policy == "catch-up"sv)
+        return Policy::CatchUp;
+
+    if (policy == "coalesce"sv)
+        return Policy::Coalesce;
+
+    if (policy == "skip"sv)
+        return Policy::Skip;
+
+    throw std::runtime_error("Unknown tick policy: "s + std::string(policy));
+}
+
+
 int main(int argc, const char* argv[])
 {
     logging::add_common_attributes();
@@ -126,35 +173,85 @@ int main(int argc, const char* argv[])
             auto pGame = json_loader::LoadGame(configPath);
             pGame->SetRandomizeSpawnPoints(args->randomize_spawn_points);
             pGame->SetTickPeriod(args->tick_period);
+            if (args->random_seed)
+                pGame->SetRandomSeed(*args->random_seed);
+            pGame->SetSimulationThreads(args->sim_threads);
 
             // 2. Инициализируем io_context
-            unsigned num_threads = 1; // std::thread::hardware_concurrency();
+            // Сетевой ввод-вывод, разбор запросов и чтение снимков - на всех ядрах, кроме одного.
+            // Модель игры живёт в отдельном потоке симуляции со своим io_context
+            // Note: hardware_concurrency() may return 0 when the number of cores is unknown
+            unsigned num_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
             asio::io_context io_context(static_cast<int>(num_threads));
+            asio::io_context game_context(1);
+            auto game_work = asio::make_work_guard(game_context);
 
             // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
             asio::signal_set signals(io_context, SIGINT, SIGTERM);
-            signals.async_wait([&io_context](const sys::error_code& ec, [[maybe_unused]] int signal_number)
+            signals.async_wait([&io_context, &game_context](const sys::error_code& ec, [[maybe_unused]] int signal_number)
             {
-                if (!ec)
+                if (!ec) {
                     io_context.stop();
+                    game_context.stop();
+                }
             });
 
             // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-            // strand для выполнения запросов к API
-            auto api_strand = asio::make_strand(io_context);
+            // strand для выполнения запросов к API, изменяющих модель; исполняется потоком симуляции
+            auto api_strand = asio::make_strand(game_context);
+            // Очередь с приоритетами перед strand: такт и вход в игру не ждут за рекордами
+            auto dispatcher = std::make_shared<app::PriorityDispatcher>(api_strand);
+
+            // Асинхронные соединения с БД: сокеты libpq обслуживаются io_context,
+            // результаты запросов возвращаются в api_strand
+            std::unique_ptr<db::AsyncConnectionPool> async_pool;
+            std::unique_ptr<db::RecordsStorage> records_storage;
+            if (conn_pool) {
+                async_pool = std::make_unique<db::AsyncConnectionPool>(io_context, db_url, 4, api_strand);
+                records_storage = std::make_unique<db::PostgresRecordsStorage>(*conn_pool, *async_pool);
+            }
+            else {
+                // Без PostgreSQL рекорды хранятся в локальном журнале
+                // Note: the file is written on the I/O threads, not in the tick
+                records_storage = std::make_unique<db::LocalRecordsStore>(args->records_file,
+                                                                          io_context.get_executor());
+            }
+
+            // Следит за длительностью такта и очередью strand API
+            app::LoadController load_controller(milliseconds(pGame->GetTickPeriod()));
 
             // Создаём обработчик запросов в куче, управляемый shared_ptr
-            auto handler = std::make_shared<http_handler::RequestHandler>(api_strand, staticPath, *pGame, conn_pool.get());
+            auto handler = std::make_shared<http_handler::RequestHandler>(dispatcher, staticPath, *pGame,
+                                                                          records_storage.get(),
+                                                                          load_controller);
+            auto request_handler = handler.get();
+            request_handler->SetRequestTimeout(milliseconds(std::max(1, args->request_timeout_ms)));
 
             server_logging::LoggingRequestHandler<http_handler::RequestHandler> logging_handler(std::move(handler));
 
             std::shared_ptr<model::Ticker> pTicker;
+            std::shared_ptr<app::TickSlicer> pSlicer;
             if (int period = pGame->GetTickPeriod(); period > 0) {
+                // Note: a tick is simulated in slices, API requests on the strand run in between
+                pSlicer = std::make_shared<app::TickSlicer>(dispatcher,
+                                                            microseconds(std::max(0, args->tick_slice_us)),
+                                                            load_controller,
+                                                            [request_handler](auto elapsed) {
+                    request_handler->BeginGameTick(elapsed.count());
+                },
+                                                            [request_handler](auto deadline) {
+                    return request_handler->StepGameTick(deadline);
+                },
+                                                            [&load_controller, &pTicker] {
+                    pTicker->SetPeriod(load_controller.GetTickPeriod());
+                });
+
+                // Note: pTicker outlives io_context.run(), the handler runs only inside it
                 pTicker = std::make_shared<model::Ticker>(api_strand,
                                                           milliseconds(period),
-                                                          [game = pGame.get()](auto && elapsed_ms) {
-                    game->Think(elapsed_ms.count());
-                });
+                                                          [&pSlicer](auto && elapsed_ms) {
+                    pSlicer->Tick(elapsed_ms);
+                }, ParseTickPolicy(args->tick_policy));
 
                 pTicker->Start();
             }
@@ -172,15 +269,60 @@ int main(int argc, const char* argv[])
                 json::object msg;
                 msg["port"]    = port;
                 msg["address"] = svAddress;
+                // Note: lets a run be repeated with --random-seed
+                msg["random_seed"] = pGame->GetRandomSeed();
 
                 BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, msg)
                                         << "server started"sv;
             }
 
-            // 6. Запускаем обработку асинхронных операций
+            // 6. Запускаем поток симуляции и обработку асинхронных операций
+            // Note: API threads reach the model only through api_strand posts and published snapshots
+            std::jthread sim_thread([&game_context, &args] {
+                if (args->sim_cpu) {
+                    if (auto err = app::PinCurrentThread(*args->sim_cpu); !err.empty())
+                        BOOST_LOG_TRIVIAL(info) << "simulation thread is not pinned: "sv << err;
+                }
+
+                if (args->sim_realtime) {
+                    if (auto err = app::SetCurrentThreadRealtime(); !err.empty())
+                        BOOST_LOG_TRIVIAL(info) << "simulation thread is not real-time: "sv << err;
+                }
+
+                game_context.run();
+            });
+
             RunWorkers(num_threads, [&io_context] {
                 io_context.run();
             });
+
+            game_context.stop();
+            sim_thread.join();
+
+            if (pTicker) {
+                const auto & stats = pTicker->GetStats();
+
+                json::object msg;
+                msg["ticks"]                = stats.ticks;
+                msg["late_ticks"]           = stats.late_ticks;
+                msg["missed_ticks"]         = stats.missed_ticks;
+                msg["max_jitter_us"]        = duration_cast<microseconds>(stats.max_jitter).count();
+                msg["total_jitter_us"]      = duration_cast<microseconds>(stats.total_jitter).count();
+                msg["max_handler_us"]       = duration_cast<microseconds>(stats.max_handler_duration).count();
+                msg["total_handler_us"]     = duration_cast<microseconds>(stats.total_handler_duration).count();
+                msg["tick_slices"]          = pSlicer->GetStats().slices;
+                msg["max_slice_us"]         = duration_cast<microseconds>(pSlicer->GetStats().max_slice).count();
+
+                const auto dispatched = dispatcher->GetStats().dispatched;
+                msg["dispatched_tick"]      = dispatched[static_cast<size_t>(app::WorkClass::Tick)];
+                msg["dispatched_gameplay"]  = dispatched[static_cast<size_t>(app::WorkClass::Gameplay)];
+                msg["dispatched_state"]     = dispatched[static_cast<size_t>(app::WorkClass::StateRead)];
+                msg["dispatched_bulk"]      = dispatched[static_cast<size_t>(app::WorkClass::Bulk)];
+                msg["dropped_requests"]     = load_controller.GetDroppedCount();
+
+                BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, msg)
+                                        << "ticker stats"sv;
+            }
         }
     }   
     catch (const std::exception& ex)
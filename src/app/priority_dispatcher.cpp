@@ -0,0 +1,71 @@
+#include "priority_dispatcher.h"
+
+#include <utility>
+
+#include <boost/asio/post.hpp>
+
+
+namespace app
+{
+
+void PriorityDispatcher::Post(WorkClass cls, Task task)
+{
+    bool schedule = false;
+    {
+        std::lock_guard lock(mutex_);
+        queue_.Push(static_cast<size_t>(cls), std::move(task));
+        schedule = !std::exchange(scheduled_, true);
+    }
+
+    if (schedule)
+        Schedule();
+}
+
+void PriorityDispatcher::Schedule()
+{
+    asio::post(strand_, [self = shared_from_this()] {
+        self->RunNext();
+    });
+}
+
+void PriorityDispatcher::RunNext()
+{
+    Task task;
+    {
+        std::lock_guard lock(mutex_);
+        auto item = queue_.Pop();
+        if (!item) {
+            scheduled_ = false;
+            return;
+        }
+
+        ++stats_.dispatched[item->first];
+        task = std::move(item->second);
+    }
+
+    // Note: one task per strand handler, the choice is made again with everything queued meanwhile
+    try {
+        task();
+    }
+    catch (...) {
+        ScheduleIfPending();
+        throw;
+    }
+
+    ScheduleIfPending();
+}
+
+void PriorityDispatcher::ScheduleIfPending()
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (queue_.Empty()) {
+            scheduled_ = false;
+            return;
+        }
+    }
+
+    Schedule();
+}
+
+}   // namespace app
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include "../lib/weighted_fair_queue.h"
+
+
+namespace app
+{
+namespace asio = boost::asio;
+
+// Классы работы на strand игры, в порядке важности
+enum class WorkClass : size_t
+{
+    Tick,       // slices of the game tick
+    Gameplay,   // joins
+    StateRead,  // state of a player not in the published snapshot yet
+    Bulk,       // records and other reads nobody plays without
+    Count
+};
+
+/*
+ *  Очередь с приоритетами перед strand игры.
+ *  Работа ставится в очередь своего класса, strand забирает по одной задаче
+ *  в порядке взвешенного справедливого обслуживания, поэтому поток запросов к рекордам
+ *  не задерживает такт и вход в игру, но и сам не простаивает, пока они заняты.
+ *  Post можно вызывать из любого потока.
+ */
+class PriorityDispatcher : public std::enable_shared_from_this<PriorityDispatcher>
+{
+public:
+    using Strand  = asio::strand<asio::io_context::executor_type>;
+    using Task    = std::move_only_function<void()>;
+    using Weights = std::array<unsigned, static_cast<size_t>(WorkClass::Count)>;
+
+    // Note: under full load the tick gets 8/15 of the strand, records 1/15
+    static constexpr Weights DEFAULT_WEIGHTS = {8, 4, 2, 1};
+
+    struct Stats
+    {
+        std::array<uint64_t, static_cast<size_t>(WorkClass::Count)> dispatched{};
+    };
+
+    explicit PriorityDispatcher(Strand strand, const Weights & weights = DEFAULT_WEIGHTS)
+        : strand_(std::move(strand))
+        , queue_(weights) {
+    }
+
+    PriorityDispatcher(const PriorityDispatcher &) = delete;
+    PriorityDispatcher & operator=(const PriorityDispatcher &) = delete;
+
+    void Post(WorkClass cls, Task task);
+
+    [[nodiscard]] const Strand & GetStrand() const noexcept {
+        return strand_;
+    }
+
+    [[nodiscard]] Stats GetStats() const {
+        std::lock_guard lock(mutex_);
+        return stats_;
+    }
+
+private:
+
+    void Schedule();
+    void ScheduleIfPending();
+    void RunNext();
+
+    Strand strand_;
+
+    mutable std::mutex mutex_;
+    util::WeightedFairQueue<Task, static_cast<size_t>(WorkClass::Count)> queue_;
+    // Note: at most one RunNext is queued on the strand at a time
+    bool scheduled_ = false;
+    Stats stats_;
+};
+
+}   // namespace app
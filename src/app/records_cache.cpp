@@ -0,0 +1,79 @@
+#include "records_cache.h"
+
+#include <algorithm>
+
+
+namespace db
+{
+
+bool RecordsCache::Less(const RecordItem & lhs, const RecordItem & rhs) noexcept
+{
+    if (lhs.score != rhs.score)
+        return lhs.score > rhs.score;
+
+    if (lhs.play_time_ms != rhs.play_time_ms)
+        return lhs.play_time_ms < rhs.play_time_ms;
+
+    if (lhs.name != rhs.name)
+        return lhs.name < rhs.name;
+
+    return lhs.id < rhs.id;
+}
+
+void RecordsCache::Load(RecordItems && items)
+{
+    items_ = std::move(items);
+    std::sort(items_.begin(), items_.end(), &RecordsCache::Less);
+
+    // Note: the table may hold more rows than were fetched
+    complete_ = items_.size() < depth_;
+    if (items_.size() > depth_)
+        items_.resize(depth_);
+
+    ++version_;
+}
+
+void RecordsCache::Insert(const RecordItem & item)
+{
+    // Note: any retirement may shift deeper pages, so version changes anyway
+    ++version_;
+
+    auto it = std::upper_bound(items_.begin(), items_.end(), item, &RecordsCache::Less);
+    if (it == items_.end() && items_.size() >= depth_) {
+        complete_ = false;
+        return;
+    }
+
+    items_.insert(it, item);
+
+    if (items_.size() > depth_) {
+        items_.pop_back();
+        complete_ = false;
+    }
+}
+
+std::optional<RecordItems> RecordsCache::GetPage(const RecordsQuery & query) const
+{
+    size_t start = query.start;
+    size_t maxItems = query.maxItems;
+
+    if (query.after) {
+        auto it = std::upper_bound(items_.begin(), items_.end(), *query.after, &RecordsCache::Less);
+        start = static_cast<size_t>(it - items_.begin());
+    }
+
+    if (!complete_ && start + maxItems > items_.size())
+        return std::nullopt;
+
+    RecordItems ret;
+
+    if (start < items_.size()) {
+        auto first = items_.begin() + static_cast<ptrdiff_t>(start);
+        auto last  = items_.begin() + static_cast<ptrdiff_t>(std::min(items_.size(), start + maxItems));
+        ret.assign(first, last);
+    }
+
+    return ret;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <optional>
+
+#include "game_db.h"
+
+
+namespace db
+{
+
+/*
+ *  Кеш таблицы рекордов.
+ *  Хранит первые depth записей в порядке score DESC, play_time_ms, name, id -
+ *  так же, как их отдаёт QUERY_SELECT_RECORDS.
+ */
+class RecordsCache
+{
+public:
+
+    explicit RecordsCache(size_t depth = MAX_NUM_RECORD_ITEMS) : depth_(depth) {
+    }
+
+    [[nodiscard]] size_t GetDepth() const noexcept {
+        return depth_;
+    }
+
+    // Version changes on every modification, used as ETag of the leaderboard
+    [[nodiscard]] uint64_t GetVersion() const noexcept {
+        return version_;
+    }
+
+    // items - top records fetched from the database (at most depth items)
+    void Load(RecordItems && items);
+
+    void Insert(const RecordItem & item);
+
+    // Returns std::nullopt when the page lies beyond the cached depth
+    [[nodiscard]] std::optional<RecordItems> GetPage(const RecordsQuery & query) const;
+
+    static bool Less(const RecordItem & lhs, const RecordItem & rhs) noexcept;
+
+private:
+
+    size_t depth_;
+    uint64_t version_ = 0;
+    // Note: true while the cache holds every record of the table
+    bool complete_ = true;
+    RecordItems items_;
+};
+
+}
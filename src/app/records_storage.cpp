@@ -0,0 +1,29 @@
+#include "records_storage.h"
+
+
+namespace db
+{
+
+PostgresRecordsStorage::PostgresRecordsStorage(ConnectionPool & connection_pool, AsyncConnectionPool & async_pool)
+                      : connection_pool_(connection_pool)
+                      , async_pool_(async_pool)
+{
+    {
+        auto conn_wrp = connection_pool.GetConnection();
+        CreateGameTable(*conn_wrp);
+    }
+
+    connection_pool.PrepareQuery(TAG_SELECT_RECORDS, QUERY_SELECT_RECORDS);
+
+    async_pool.PrepareQuery(std::string(TAG_SELECT_RECORDS), std::string(QUERY_SELECT_RECORDS));
+    async_pool.PrepareQuery(std::string(TAG_SELECT_RECORDS_AFTER), std::string(QUERY_SELECT_RECORDS_AFTER));
+    async_pool.PrepareQuery(std::string(TAG_INSERT_PLAYER), std::string(QUERY_INSERT_PLAYER));
+}
+
+RecordItems PostgresRecordsStorage::LoadTop(size_t maxItems)
+{
+    auto conn_wrp = connection_pool_.GetConnection();
+    return db::FetchRecords(*conn_wrp, 0, static_cast<int>(maxItems));
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "game_db.h"
+#include "connection_pool.h"
+#include "async_connection_pool.h"
+
+
+namespace db
+{
+
+/*
+ *  Хранилище таблицы рекордов.
+ *  Все методы вызываются на strand API, handler также вызывается на нём.
+ */
+class RecordsStorage
+{
+public:
+
+    virtual ~RecordsStorage() = default;
+
+    // Blocking, called once at startup to warm up the leaderboard cache
+    [[nodiscard]] virtual RecordItems LoadTop(size_t maxItems) = 0;
+
+    virtual void FetchRecords(const RecordsQuery & query, RecordsHandler handler) = 0;
+
+    virtual void InsertRecord(const RecordItem & item) = 0;
+};
+
+
+class PostgresRecordsStorage : public RecordsStorage
+{
+public:
+
+    // connection_pool is used at startup only, async_pool serves requests at runtime
+    PostgresRecordsStorage(ConnectionPool & connection_pool, AsyncConnectionPool & async_pool);
+
+    [[nodiscard]] RecordItems LoadTop(size_t maxItems) override;
+
+    void FetchRecords(const RecordsQuery & query, RecordsHandler handler) override {
+        AsyncFetchRecords(async_pool_, query, std::move(handler));
+    }
+
+    void InsertRecord(const RecordItem & item) override {
+        AsyncInsertRetiredPlayer(async_pool_, item);
+    }
+
+private:
+
+    ConnectionPool & connection_pool_;
+    AsyncConnectionPool & async_pool_;
+};
+
+}
@@ -1,4 +1,5 @@
 #include "request_handler.h"
+#include <charconv>
 #include <iostream>
 #include <boost/json.hpp>
 #include <boost/url.hpp>
@@ -55,14 +56,17 @@ FileResponse MakeFileResponse(http::status                status,
     return response;
 }
 
-RequestHandler::RequestHandler(Strand api_strand,
+RequestHandler::RequestHandler(std::shared_ptr<app::PriorityDispatcher> dispatcher,
                                std::filesystem::path path_static,
                                model::Game &game,
-                               db::ConnectionPool * connection_pool)
-              : api_strand_(std::move(api_strand))
+                               db::RecordsStorage * records_storage,
+                               app::LoadController & load_controller)
+              : dispatcher_(std::move(dispatcher))
+              , api_strand_(dispatcher_->GetStrand())
               , path_static_(std::move(path_static))
+              , load_controller_(load_controller)
 {
-    api_handler_ptr_ = std::make_unique<api_handler::ApiHandler>(game, connection_pool);
+    api_handler_ptr_ = std::make_unique<api_handler::ApiHandler>(game, records_storage, load_controller);
 }
 
 void RequestHandler::ReportError(beast::error_code ec, std::string_view what)
@@ -83,6 +87,28 @@ StringResponse RequestHandler::ReportServerError(std::string_view code, std::str
                               version, keep_alive, ContentType::APP_JSON);
 }
 
+StringResponse RequestHandler::ReportRequestExpired(unsigned version, bool keep_alive) const
+{
+    // Note: 503 also gets Retry-After there
+    auto rsp = api_handler_ptr_->MakeErrorResponse(api_handler::errors::REQUEST_EXPIRED, version, keep_alive);
+    rsp.set(http::field::cache_control, "no-cache"sv);
+
+    return rsp;
+}
+
+RequestHandler::Clock::time_point RequestHandler::GetRequestDeadline(std::string_view timeout_header) const
+{
+    auto timeout = request_timeout_;
+
+    // Note: the client can only shorten the server policy, not extend it
+    int64_t ms = 0;
+    if (auto [ptr, ec] = std::from_chars(timeout_header.data(), timeout_header.data() + timeout_header.size(), ms);
+        ec == std::errc{} && ptr == timeout_header.data() + timeout_header.size() && ms > 0)
+        timeout = std::min(timeout, std::chrono::milliseconds(ms));
+
+    return Clock::now() + timeout;
+}
+
 static std::string_view mime_type(const std::filesystem::path & path)
 {
     using beast::iequals;
@@ -121,12 +147,10 @@ RequestHandler::RestApiRes RequestHandler::OnFileFetch(const std::filesystem::pa
     auto pFileBody = std::make_unique<http::file_body::value_type>();
     if (sys::error_code ec; pFileBody->open(path.c_str(), beast::file_mode::read, ec), ec)
     {
-        std::stringstream ss;
-        ss << "Failed to open file `"sv << path << '`';
         return
         {
             http::status::not_found,
-            ss.str(),
+            "Failed to open file"sv,
             ContentType::TEXT_PLAIN,
             nullptr
         };
@@ -159,15 +183,10 @@ RequestHandler::RestApiRes RequestHandler::HandleStaticRequest(std::string_view
             if (fs::exists(absPath))
                 res = OnFileFetch(absPath);
             else
-                ThrowInvalidFilePath(uriFilename);
+                res = {http::status::not_found, "Invalid file path"sv, ContentType::TEXT_PLAIN, nullptr};
         }
         else
-            ThrowNotAllowedPath(uriFilename);
-    }
-    else if (url_view .has_error())
-    {
-        auto sErr = "Failed parse URI with error: "s + url_view.error().message();
-        res = OnBadRequest("badRequest"sv, sErr);
+            res = {http::status::bad_request, "Not allowed path"sv, ContentType::TEXT_PLAIN, nullptr};
     }
     else
         res = OnBadRequest();
@@ -175,45 +194,15 @@ RequestHandler::RestApiRes RequestHandler::HandleStaticRequest(std::string_view
     return res;
 }
 
-RequestHandler::RestApiRes RequestHandler::OnBadRequest(std::string_view code, std::string_view message) const
+RequestHandler::RestApiRes RequestHandler::OnBadRequest() const
 {
-    boost::json::object jsonErr;
-    jsonErr["code"]    = code;
-    jsonErr["message"] = message;
-
     return
     {
         http::status::bad_request,
-        boost::json::serialize(jsonErr),
+        R"json({"code":"badRequest","message":"Bad request"})json"sv,
         ContentType::APP_JSON,
         nullptr
     };
 }
 
-void RequestHandler::ThrowInvalidFilePath(std::string_view uriFilename)
-{
-    RestApiRes err = 
-    {
-        http::status::not_found,
-        "Invalid file path: "s + uriFilename.data(),
-        ContentType::TEXT_PLAIN,
-        nullptr
-    };
-
-    throw err;
-}
-
-void RequestHandler::ThrowNotAllowedPath(std::string_view uriFilename)
-{
-    RestApiRes err = 
-    {
-        http::status::bad_request,
-        "Not allowed path: "s + uriFilename.data(),
-        ContentType::TEXT_PLAIN,
-        nullptr
-    };
-
-    throw err;
-}
-
 }
@@ -50,26 +50,33 @@ FileResponse    MakeFileResponse  (http::status                status,
 class RequestHandler : public std::enable_shared_from_this<RequestHandler>
 {
     using FileBodyPtr   = std::unique_ptr<http::file_body::value_type>;
-    using RestApiRes    = std::tuple<http::status, std::string, std::string_view, FileBodyPtr>;
+    // Note: error bodies are constant strings, a bad static request builds nothing
+    using RestApiRes    = std::tuple<http::status, std::string_view, std::string_view, FileBodyPtr>;
     using ApiHandlerPtr = std::unique_ptr<api_handler::ApiHandler>;
 
 public:
 
     using Strand = asio::strand<asio::io_context::executor_type>;
 
-    RequestHandler(Strand api_strand,
+    RequestHandler(std::shared_ptr<app::PriorityDispatcher> dispatcher,
                    std::filesystem::path path_static,
                    model::Game& game,
-                   db::ConnectionPool * connection_pool);
+                   db::RecordsStorage * records_storage,
+                   app::LoadController & load_controller);
 
                     RequestHandler  (const RequestHandler&) = delete;
     RequestHandler& operator=       (const RequestHandler&) = delete;
 
 
+    // Note: a client may ask for a shorter deadline with this header, in milliseconds
+    constexpr static std::string_view X_REQUEST_TIMEOUT = "X-Request-Timeout";
+    constexpr static std::chrono::milliseconds DEFAULT_REQUEST_TIMEOUT{10000};
+
     template <typename Body, typename Allocator, typename Send>
     void operator()(const asio::ip::tcp::endpoint & endpoint,
                     http::request<Body, http::basic_fields<Allocator>> && req,
-                    Send&& send)
+                    Send&& send,
+                    http_server::CancellationTokenPtr cancel)
     {
         // Обработать запрос request и отправить ответ, используя send
 
@@ -77,33 +84,85 @@ public:
 
         if (auto target = req.target(); target.starts_with("/api/"))
         {
-            auto handle = [self = shared_from_this(), send, target,
-                           req = std::forward<decltype(req)>(req)] {
+            // Note: the request is parsed and validated here, on the I/O thread.
+            // Player actions, snapshot reads, maps and bad requests never reach the strand
+            api_handler::ApiHandler::DecodedRequest decoded;
+            try
+            {
+                decoded = api_handler_ptr_->HandleApiRequest(req.method(),
+                                                             target,
+                                                             req[http::field::content_type],
+                                                             req.body(),
+                                                             req[http::field::authorization],
+                                                             req.version(),
+                                                             req.keep_alive());
+            }
+            catch (...)
+            {
+                return send(ReportServerError("", "exception gained", req.version(), req.keep_alive()));
+            }
+
+            if (auto rsp = std::get_if<StringResponse>(&decoded))
+                return send(std::move(*rsp));
+
+            const auto work_class = api_handler::GetWorkClass(std::get<api_handler::ApiCommand>(decoded));
+
+            auto handle = [self = shared_from_this(), send, cancel = std::move(cancel),
+                           deadline = GetRequestDeadline(req[X_REQUEST_TIMEOUT]),
+                           command = std::get<api_handler::ApiCommand>(std::move(decoded)),
+                           version = req.version(), keep_alive = req.keep_alive(),
+                           if_none_match = std::string(req[http::field::if_none_match])]() mutable {
                 
+                self->load_controller_.OnRequestStarted();
+
+                // Note: nobody waits for the answer any more, the strand is not spent on it.
+                // The session has closed the connection, it ends when send is released with this handler
+                if (cancel->IsCancelled()) {
+                    self->load_controller_.OnRequestDropped();
+                    return;
+                }
+                if (Clock::now() >= deadline) {
+                    self->load_controller_.OnRequestDropped();
+                    return send(self->ReportRequestExpired(version, keep_alive));
+                }
+
                 try
                 {
                     // Этот assert не выстрелит, так как лямбда-функция будет выполняться внутри strand
                     assert(self->api_strand_.running_in_this_thread());
 
-                    const std::string_view body          = req.body();
-                    const std::string_view content_type  = req[http::field::content_type];
-                    const std::string_view authorization = req[http::field::authorization];
-
-                    return send(self->api_handler_ptr_->HandleApiRequest(req.method(),
-                                                                         target,
-                                                                         content_type,
-                                                                         body,
-                                                                         authorization,
-                                                                         req.version(),
-                                                                         req.keep_alive()));
+                    // Note: the response may come later from another strand callback (e.g. database query)
+                    api_handler::ResponseSender sender = [send, cancel, if_none_match = std::move(if_none_match)]
+                                                         (StringResponse && rsp) {
+                        if (cancel->IsCancelled())
+                            return;
+
+                        // Note: conditional GET, client already has this representation
+                        if (const auto etag = rsp[http::field::etag];
+                            !etag.empty() && etag == if_none_match) {
+                            rsp.result(http::status::not_modified);
+                            rsp.body().clear();
+                            rsp.erase(http::field::content_length);
+                        }
+
+                        send(std::move(rsp));
+                    };
+
+                    if (auto rsp = self->api_handler_ptr_->ExecuteApiCommand(std::move(command),
+                                                                             version,
+                                                                             keep_alive,
+                                                                             sender); rsp)
+                        sender(std::move(*rsp));
                 }
                 catch (...)
                 {
-                    send(self->ReportServerError("", "exception gained", req.version(), req.keep_alive()));
+                    send(self->ReportServerError("", "exception gained", version, keep_alive));
                 }
             };
             
-            return asio::dispatch(api_strand_, handle);
+            // Note: queue length of the strand is one of the load signals
+            load_controller_.OnRequestQueued();
+            return dispatcher_->Post(work_class, std::move(handle));
         }
         else if (http::verb::get == req.method() || http::verb::head == req.method())
         {
@@ -117,24 +176,17 @@ public:
                 send(rsp);
             };
 
-            try
-            {
-                if (auto res = HandleStaticRequest(target); std::get<3>(res) != nullptr)
-                {
-                    auto rsp = MakeFileResponse(std::get<0>(res),
-                                                std::move(*std::get<3>(res)),
-                                                req.version(),
-                                                req.keep_alive(),
-                                                std::get<2>(res));
-                    send(rsp);
-                }
-                else
-                    fnSendErr(std::move(res), std::move(send));
-            }
-            catch (const RestApiRes & err)
+            if (auto res = HandleStaticRequest(target); std::get<3>(res) != nullptr)
             {
-                fnSendErr(std::move(err), std::move(send));
+                auto rsp = MakeFileResponse(std::get<0>(res),
+                                            std::move(*std::get<3>(res)),
+                                            req.version(),
+                                            req.keep_alive(),
+                                            std::get<2>(res));
+                send(rsp);
             }
+            else
+                fnSendErr(std::move(res), std::move(send));
         }
         else
             isBadRequest = true;
@@ -152,22 +204,49 @@ public:
 
     void ReportError (beast::error_code ec, std::string_view what);
 
+    // Server policy, the longest time a request may wait for the strand. Set before the server starts
+    void SetRequestTimeout(std::chrono::milliseconds timeout) noexcept {
+        request_timeout_ = timeout;
+    }
+
+    // Must be called inside api_strand
+    void ProcessGameTick(int64_t elapsedMs) {
+        assert(api_strand_.running_in_this_thread());
+        api_handler_ptr_->ProcessGameTick(elapsedMs);
+    }
+
+    // Must be called inside api_strand. StepGameTick returns true when the tick is complete
+    void BeginGameTick(int64_t elapsedMs) {
+        assert(api_strand_.running_in_this_thread());
+        api_handler_ptr_->BeginGameTick(elapsedMs);
+    }
+
+    bool StepGameTick(model::TimePoint deadline) {
+        assert(api_strand_.running_in_this_thread());
+        return api_handler_ptr_->StepGameTick(deadline);
+    }
+
 private:
 
+    using Clock = std::chrono::steady_clock;
+
     StringResponse ReportServerError(std::string_view code, std::string_view error, unsigned version, bool keep_alive) const;
+    StringResponse ReportRequestExpired(unsigned version, bool keep_alive) const;
+
+    [[nodiscard]] Clock::time_point GetRequestDeadline(std::string_view timeout_header) const;
 
 
     RestApiRes HandleStaticRequest(std::string_view filename) const;
     RestApiRes OnFileFetch(const std::filesystem::path & path) const;
-    RestApiRes OnBadRequest(std::string_view code = "badRequest", std::string_view message = "Bad request") const;
-
-    static void ThrowInvalidFilePath(std::string_view uriFilename);
-    static void ThrowNotAllowedPath(std::string_view uriFilename);
+    RestApiRes OnBadRequest() const;
 
 
+    std::shared_ptr<app::PriorityDispatcher> dispatcher_;
     Strand api_strand_;
     std::filesystem::path path_static_;
     ApiHandlerPtr api_handler_ptr_;
+    app::LoadController & load_controller_;
+    std::chrono::milliseconds request_timeout_ = DEFAULT_REQUEST_TIMEOUT;
     
 };
 
@@ -0,0 +1,149 @@
+#include "session_snapshots.h"
+
+#include <algorithm>
+#include <boost/json.hpp>
+
+
+using namespace std::string_view_literals;
+namespace json = boost::json;
+
+
+namespace app
+{
+
+bool SessionSnapshot::HasPlayer(model::Player::Id id) const noexcept
+{
+    return std::binary_search(players.begin(), players.end(), id);
+}
+
+std::string SerializeSessionState(const model::GameSession & session)
+{
+    json::object reply;
+    reply["players"] = json::object();
+    auto & players = reply["players"].as_object();
+
+    for (const model::Player * player : session.GetPlayers()) {
+        if (auto pDog = player->GetDog(); pDog) {
+            auto         pos = pDog->GetPosition();
+            const auto & vel = pDog->GetVelocity();
+
+            json::object data;
+            data["pos"]   = json::array( { pos.x, pos.y } );
+            data["speed"] = json::array( { vel.x, vel.y } );
+            data["dir"]   = pDog->GetDirectionCode();
+
+            json::array bag;
+            for (const auto & p : pDog->GetGatheredItems()) {
+                json::object loot;
+                loot["id"] = p->id;
+                loot["type"] = p->type;
+
+                bag.push_back(std::move(loot));
+            }
+            data["bag"] = std::move(bag);
+            data["score"] = pDog->GetScore();
+
+            players.insert_or_assign(std::to_string(player->GetId()), std::move(data));
+        }
+    }
+
+    if (!session.GetLootInstances().empty()) {
+        reply["lostObjects"] = json::object();
+        auto & lostObjects = reply["lostObjects"].as_object();
+
+        for (const auto & itLoot : session.GetLootInstances()) {
+
+            json::object data;
+            data["type"sv] = itLoot->type;
+            data["pos"sv] = json::array( { itLoot->pos.x, itLoot->pos.y } );
+
+            lostObjects.insert_or_assign(std::to_string(itLoot->id), std::move(data));
+        }
+    }
+
+    return json::serialize(reply);
+}
+
+std::string SerializeSessionPlayers(const model::GameSession & session)
+{
+    json::object reply;
+
+    for (const model::Player * player : session.GetPlayers()) {
+        json::object j;
+        j["name"sv] = player->GetName();
+        reply[std::to_string(player->GetId())] = std::move(j);
+    }
+
+    return json::serialize(reply);
+}
+
+SessionSnapshotPtr MakeSessionSnapshot(const model::GameSession & session)
+{
+    auto snapshot = std::make_shared<SessionSnapshot>();
+
+    snapshot->players.reserve(session.GetPlayersCount());
+    for (const model::Player * player : session.GetPlayers())
+        snapshot->players.push_back(player->GetId());
+    std::ranges::sort(snapshot->players);
+
+    snapshot->state_body   = SerializeSessionState(session);
+    snapshot->players_body = SerializeSessionPlayers(session);
+
+    return snapshot;
+}
+
+void SessionSnapshots::BeginPublishAll(const std::vector<model::GameSession *> & sessions)
+{
+    pending_ = std::make_shared<Table>();
+    pending_->reserve(sessions.size());
+
+    pending_sessions_.assign(sessions.begin(), sessions.end());
+    pending_index_ = 0;
+}
+
+bool SessionSnapshots::PublishStep(model::TimePoint deadline)
+{
+    if (!pending_)
+        return true;
+
+    do {
+        if (pending_index_ == pending_sessions_.size()) {
+            table_.store(TablePtr(std::move(pending_)), std::memory_order_release);
+            pending_sessions_.clear();
+            return true;
+        }
+
+        // Note: a session queued twice is serialized again, the later snapshot wins
+        const model::GameSession * session = pending_sessions_[pending_index_++];
+        (*pending_)[session->GetId()] = MakeSessionSnapshot(*session);
+    } while (deadline == model::TimePoint::max() || model::Clock::now() < deadline);
+
+    return false;
+}
+
+void SessionSnapshots::Publish(const model::GameSession & session)
+{
+    // Note: the table being built replaces the current one, a snapshot published aside would be lost
+    if (pending_) {
+        pending_sessions_.push_back(&session);
+        return;
+    }
+
+    // Note: copy of the table holds only pointers, the snapshots of other sessions are shared
+    auto table = std::make_shared<Table>(*table_.load(std::memory_order_acquire));
+    (*table)[session.GetId()] = MakeSessionSnapshot(session);
+
+    table_.store(std::move(table), std::memory_order_release);
+}
+
+SessionSnapshotPtr SessionSnapshots::Find(model::GameSession::Id id) const
+{
+    const auto table = table_.load(std::memory_order_acquire);
+
+    if (auto it = table->find(id); it != table->end())
+        return it->second;
+
+    return nullptr;
+}
+
+}   // namespace app
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../lib/model.h"
+
+
+namespace app
+{
+
+// Immutable state of a game session at the end of a tick, ready to be sent
+struct SessionSnapshot
+{
+    std::vector<model::Player::Id> players;     // sorted
+    std::string state_body;                     // game/state reply
+    std::string players_body;                   // game/players reply
+
+    [[nodiscard]] bool HasPlayer(model::Player::Id id) const noexcept;
+};
+
+using SessionSnapshotPtr = std::shared_ptr<const SessionSnapshot>;
+
+// Bodies of the session replies, used for snapshots and for the fresh state on the strand
+std::string SerializeSessionState(const model::GameSession & session);
+std::string SerializeSessionPlayers(const model::GameSession & session);
+
+SessionSnapshotPtr MakeSessionSnapshot(const model::GameSession & session);
+
+
+/*
+ *  Опубликованные снимки сессий (read-copy-update).
+ *  Пишет только strand игры: строит новую таблицу и атомарно подменяет указатель.
+ *  Читатели из любых потоков берут текущую таблицу без блокировок strand;
+ *  старая таблица и снимки освобождаются, когда их отпустит последний читатель.
+ */
+class SessionSnapshots
+{
+    using Table    = std::unordered_map<model::GameSession::Id, SessionSnapshotPtr>;
+    using TablePtr = std::shared_ptr<const Table>;
+
+public:
+
+    // Replaces all snapshots in steps: BeginPublishAll, then PublishStep until it returns true.
+    // Sessions missing from the list are dropped, readers see the new table only when it is complete
+    void BeginPublishAll(const std::vector<model::GameSession *> & sessions);
+    // Serializes at least one session per call, then goes on until the deadline
+    bool PublishStep(model::TimePoint deadline);
+
+    [[nodiscard]] bool IsPublishing() const noexcept {
+        return pending_ != nullptr;
+    }
+
+    // Replaces the snapshot of one session, the others are kept.
+    // Note: while a table is being built, the session is queued into it instead
+    void Publish(const model::GameSession & session);
+
+    // Thread safe
+    [[nodiscard]] SessionSnapshotPtr Find(model::GameSession::Id id) const;
+
+private:
+
+    std::atomic<TablePtr> table_{std::make_shared<const Table>()};
+
+    // Таблица, которая строится по шагам, и сессии для неё
+    std::shared_ptr<Table> pending_;
+    std::vector<const model::GameSession *> pending_sessions_;
+    size_t pending_index_ = 0;
+};
+
+}   // namespace app
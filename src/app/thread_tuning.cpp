@@ -0,0 +1,51 @@
+#include "thread_tuning.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std::literals;
+
+
+namespace app
+{
+
+std::string PinCurrentThread([[maybe_unused]] unsigned cpu)
+{
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE)
+        return "CPU number is out of range"s;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    if (int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); err != 0)
+        return std::strerror(err);
+
+    return {};
+#else
+    return "CPU pinning is not supported on this platform"s;
+#endif
+}
+
+std::string SetCurrentThreadRealtime()
+{
+#ifdef __linux__
+    // Note: the middle of the range, leaves room above for kernel threads and watchdogs
+    sched_param param{};
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+
+    if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+        return std::strerror(err);
+
+    return {};
+#else
+    return "Real-time scheduling is not supported on this platform"s;
+#endif
+}
+
+}   // namespace app
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+
+namespace app
+{
+
+// Both functions apply to the calling thread and return an error description, empty on success.
+// Note: a failure is not fatal, the thread keeps running with the default settings
+
+// Binds the thread to one CPU
+std::string PinCurrentThread(unsigned cpu);
+
+// Switches the thread to the SCHED_FIFO real-time policy, usually needs CAP_SYS_NICE
+std::string SetCurrentThreadRealtime();
+
+}   // namespace app
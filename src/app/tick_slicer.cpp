@@ -0,0 +1,66 @@
+#include "tick_slicer.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std::chrono_literals;
+
+
+namespace app
+{
+
+void TickSlicer::Tick(milliseconds elapsed)
+{
+    assert(dispatcher_->GetStrand().running_in_this_thread());
+
+    pending_ += elapsed;
+
+    if (!running_) {
+        running_ = true;
+        busy_ = {};
+        StartNext();
+        RunSlice();
+    }
+}
+
+void TickSlicer::StartNext()
+{
+    // Note: a coalesced tick after a stall may cover seconds, simulate it in bounded steps
+    const auto step = std::min(pending_, load_controller_.GetMaxStep());
+    pending_ -= step;
+
+    begin_(step);
+}
+
+void TickSlicer::RunSlice()
+{
+    const auto started = Clock::now();
+    const auto deadline = budget_ > Clock::duration::zero() ? started + budget_ : Clock::time_point::max();
+
+    bool complete = step_(deadline);
+    while (complete && pending_ > 0ms && Clock::now() < deadline) {
+        StartNext();
+        complete = step_(deadline);
+    }
+
+    const auto slice = Clock::now() - started;
+    busy_ += slice;
+    ++stats_.slices;
+    stats_.max_slice = std::max(stats_.max_slice, slice);
+
+    if (complete && pending_ > 0ms)
+        StartNext();
+    else if (complete) {
+        running_ = false;
+        load_controller_.OnTick(busy_);
+        done_();
+        return;
+    }
+
+    // Note: queued, not run inline - API requests queued meanwhile get their weighted share before the next slice
+    dispatcher_->Post(WorkClass::Tick, [self = shared_from_this()] {
+        self->RunSlice();
+    });
+}
+
+}   // namespace app
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "load_controller.h"
+#include "priority_dispatcher.h"
+
+
+namespace app
+{
+
+/*
+ *  Выполняет такт игры частями.
+ *  Каждая часть работает не дольше бюджета и снова ставится в очередь strand (класс Tick диспетчера),
+ *  поэтому запросы API, пришедшие во время большого такта, ждут не весь такт, а одну часть.
+ *  Время, пришедшее от таймера во время незаконченного такта, добавляется к следующему такту.
+ */
+class TickSlicer : public std::enable_shared_from_this<TickSlicer>
+{
+public:
+    using Clock        = std::chrono::steady_clock;
+    using milliseconds = std::chrono::milliseconds;
+
+    // Starts a tick covering elapsed time
+    using BeginFn = std::function<void(milliseconds elapsed)>;
+    // Runs the started tick until the deadline, returns true when the tick is complete
+    using StepFn  = std::function<bool(Clock::time_point deadline)>;
+    // Called when all the time is simulated
+    using DoneFn  = std::function<void()>;
+
+    struct Stats
+    {
+        uint64_t slices = 0;
+        Clock::duration max_slice{};
+    };
+
+    // budget == 0 - a tick runs in one piece
+    TickSlicer(std::shared_ptr<PriorityDispatcher> dispatcher, Clock::duration budget, LoadController & load_controller,
+               BeginFn begin, StepFn step, DoneFn done)
+        : dispatcher_(std::move(dispatcher))
+        , budget_(budget)
+        , load_controller_(load_controller)
+        , begin_(std::move(begin))
+        , step_(std::move(step))
+        , done_(std::move(done)) {
+    }
+
+    // Must be called inside the strand
+    void Tick(milliseconds elapsed);
+
+    [[nodiscard]] bool IsRunning() const noexcept {
+        return running_;
+    }
+
+    [[nodiscard]] const Stats & GetStats() const noexcept {
+        return stats_;
+    }
+
+private:
+
+    void StartNext();
+    void RunSlice();
+
+    std::shared_ptr<PriorityDispatcher> dispatcher_;
+    Clock::duration budget_;
+    LoadController & load_controller_;
+    BeginFn begin_;
+    StepFn step_;
+    DoneFn done_;
+
+    milliseconds pending_{0};
+    // Note: time spent inside the slices, not the wall time of the tick
+    Clock::duration busy_{};
+    bool running_ = false;
+    Stats stats_;
+};
+
+}   // namespace app
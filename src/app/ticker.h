@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <memory>
 
 #include <boost/asio/io_context.hpp>
@@ -15,39 +18,129 @@ namespace sys  = boost::system;
 class Ticker : public std::enable_shared_from_this<Ticker>
 {
 public:
-    using Strand  = asio::strand<asio::io_context::executor_type>;
-    using Handler = std::function<void(std::chrono::milliseconds delta)>;
-
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+    using Clock    = std::chrono::steady_clock;
+    using Strand   = asio::strand<asio::io_context::executor_type>;
+    using Handler  = std::function<void(std::chrono::milliseconds delta)>;
+
+    // What to do when the handler could not keep up and deadlines were missed
+    enum class MissedTickPolicy
+    {
+        CatchUp,    // run every missed tick back to back, each with delta == period
+        Coalesce,   // run one tick covering all the elapsed time
+        Skip        // run one tick with delta == period, the missed time is dropped
+    };
+
+    struct Stats
+    {
+        uint64_t ticks = 0;
+        uint64_t late_ticks = 0;        // ticks fired a period or more after their deadline
+        uint64_t missed_ticks = 0;      // whole periods coalesced or skipped
+        Clock::duration max_jitter{};   // how late the timer fired after the deadline
+        Clock::duration total_jitter{};
+        Clock::duration last_handler_duration{};
+        Clock::duration max_handler_duration{};
+        Clock::duration total_handler_duration{};
+    };
+
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler,
+           MissedTickPolicy policy = MissedTickPolicy::Coalesce)
             : strand_(std::move(strand))
-            , handler_(std::move(handler)) {
+            , handler_(std::move(handler))
+            , policy_(policy) {
         period_ = period;
     }
 
     void Start() {
-        last_tick_ = std::chrono::steady_clock::now();
-        timer_.expires_after(period_);
+        last_tick_ = Clock::now();
+        deadline_  = last_tick_ + period_;
 
         ScheduleTick();
     }
 
+    // Moves the deadline of the tick already armed as well, may be called from the handler
+    void SetPeriod(std::chrono::milliseconds period) {
+        deadline_ += period - period_;
+        period_ = period;
+
+        // Note: nothing is pending inside the handler or before Start, ScheduleTick arms the timer then.
+        // A tick which has fired already and waits for the strand is caught by the check in OnTick
+        if (timer_.expires_at(deadline_) > 0)
+            AsyncWait();
+    }
+
+    [[nodiscard]] std::chrono::milliseconds GetPeriod() const noexcept {
+        return period_;
+    }
+
+    [[nodiscard]] const Stats & GetStats() const noexcept {
+        return stats_;
+    }
+
 private:
 
     void ScheduleTick() {
+        // Note: absolute deadline, handler time does not shift the schedule
+        timer_.expires_at(deadline_);
+        AsyncWait();
+    }
 
-        timer_.async_wait([this](const auto & ec) {
-            OnTick(ec);
+    void AsyncWait() {
+        timer_.async_wait([self = shared_from_this()](const sys::error_code & ec) {
+            self->OnTick(ec);
         });
     }
 
     void OnTick(const sys::error_code & ec) {
 
-        auto current_tick = std::chrono::steady_clock::now();
-        auto elapsed_ms = duration_cast<std::chrono::milliseconds>(current_tick - last_tick_);
+        if (ec)
+            return;
+
+        auto current_tick = Clock::now();
+
+        // Note: fired for a deadline which SetPeriod has moved later
+        if (current_tick < deadline_)
+            return ScheduleTick();
+
+        const auto missed = std::max<Clock::rep>((current_tick - deadline_) / period_, 0);
+
+        const auto jitter = std::max<Clock::duration>(current_tick - deadline_, {});
+        stats_.max_jitter    = std::max(stats_.max_jitter, jitter);
+        stats_.total_jitter += jitter;
+
+        if (missed > 0)
+            ++stats_.late_ticks;
+
+        std::chrono::milliseconds delta = period_;
+
+        switch (policy_) {
+        case MissedTickPolicy::CatchUp:
+            // Note: deadline stays in the past until all missed ticks are run
+            deadline_ += period_;
+            break;
+
+        case MissedTickPolicy::Coalesce:
+            // Note: the sub-millisecond remainder stays in last_tick_ and goes to the next tick
+            delta = duration_cast<std::chrono::milliseconds>(current_tick - last_tick_);
+            [[fallthrough]];
+
+        case MissedTickPolicy::Skip:
+            stats_.missed_ticks += static_cast<uint64_t>(missed);
+            deadline_ += period_ * (missed + 1);
+            break;
+        }
+
+        handler_(delta);
 
-        handler_(elapsed_ms);
+        auto handler_duration = Clock::now() - current_tick;
+        ++stats_.ticks;
+        stats_.last_handler_duration   = handler_duration;
+        stats_.max_handler_duration    = std::max(stats_.max_handler_duration, handler_duration);
+        stats_.total_handler_duration += handler_duration;
 
-        last_tick_ = current_tick;
+        if (policy_ == MissedTickPolicy::Coalesce)
+            last_tick_ += delta;
+        else
+            last_tick_ = current_tick;
 
         ScheduleTick();
     }
@@ -56,8 +149,11 @@ private:
     asio::steady_timer timer_{strand_};
     std::chrono::milliseconds period_{};
     Handler handler_;
+    MissedTickPolicy policy_;
 
-    std::chrono::steady_clock::time_point last_tick_;
+    Clock::time_point last_tick_;
+    Clock::time_point deadline_;
+    Stats stats_;
 };
 
 }
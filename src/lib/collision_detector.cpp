@@ -1,5 +1,7 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+#include <utility>
 
 namespace collision_detector
 {
@@ -25,6 +27,40 @@ CollectionResult TryCollectPoint(const glm::dvec2 & a, const glm::dvec2 & b, con
     return CollectionResult(sq_distance, proj_ratio);
 }
 
+namespace
+{
+
+bool EventLess(const GatheringEvent & e_l, const GatheringEvent & e_r)
+{
+    if (e_l.time != e_r.time)
+        return e_l.time < e_r.time;
+    if (e_l.gatherer_id != e_r.gatherer_id)
+        return e_l.gatherer_id < e_r.gatherer_id;
+    return e_l.item_id < e_r.item_id;
+}
+
+bool IsStill(const Gatherer & gatherer)
+{
+    return gatherer.start_pos.x == gatherer.end_pos.x && gatherer.start_pos.y == gatherer.end_pos.y;
+}
+
+glm::dvec2 MinPoint(const glm::dvec2 & a, const glm::dvec2 & b)
+{
+    return {std::min(a.x, b.x), std::min(a.y, b.y)};
+}
+
+glm::dvec2 MaxPoint(const glm::dvec2 & a, const glm::dvec2 & b)
+{
+    return {std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
+// Gatherers checked by one task of FindGatherEventsInGrid
+constexpr size_t GATHERERS_PER_TASK = 64;
+// Note: keeps the grid small when items are spread far apart relative to the cell size
+constexpr size_t MAX_GRID_CELLS = size_t{1} << 20;
+
+}  // namespace
+
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider)
 {
     std::vector<GatheringEvent> detected_events;
@@ -53,10 +89,141 @@ std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provide
         }
     }
 
-    std::sort(detected_events.begin(), detected_events.end(),
-              [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
-                  return e_l.time < e_r.time;
-              });
+    std::sort(detected_events.begin(), detected_events.end(), EventLess);
+
+    return detected_events;
+}
+
+std::vector<GatheringEvent> FindGatherEventsInGrid(const ItemGathererProvider& provider,
+                                                   double cell_size,
+                                                   const ParallelFor & parallel_for)
+{
+    assert(cell_size > 0);
+
+    std::vector<Item> items(provider.ItemsCount());
+    for (size_t i = 0; i < items.size(); ++i)
+        items[i] = provider.GetItem(i);
+
+    std::vector<Gatherer> gatherers(provider.GatherersCount());
+    for (size_t g = 0; g < gatherers.size(); ++g)
+        gatherers[g] = provider.GetGatherer(g);
+
+    if (items.empty() || gatherers.empty())
+        return {};
+
+    // Сетка покрывает прямоугольник, в котором лежат предметы
+    glm::dvec2 lo = items.front().position;
+    glm::dvec2 hi = lo;
+    double max_item_width = 0;
+    for (const auto & item : items) {
+        lo = MinPoint(lo, item.position);
+        hi = MaxPoint(hi, item.position);
+        max_item_width = std::max(max_item_width, item.width);
+    }
+
+    const auto cells_along = [&](double extent) {
+        return static_cast<size_t>(extent / cell_size) + 1;
+    };
+    while (cells_along(hi.x - lo.x) * cells_along(hi.y - lo.y) > MAX_GRID_CELLS)
+        cell_size *= 2;
+
+    const size_t cols = cells_along(hi.x - lo.x);
+    const size_t rows = cells_along(hi.y - lo.y);
+
+    const auto clamp_cell = [&](double v, double origin, size_t count) -> size_t {
+        const double c = std::floor((v - origin) / cell_size);
+        if (c < 0)
+            return 0;
+        return std::min(count - 1, static_cast<size_t>(c));
+    };
+
+    // Note: items of a cell are contiguous - cell_start[c] .. cell_start[c + 1] in cell_items
+    std::vector<size_t> item_cell(items.size());
+    std::vector<size_t> cell_start(cols * rows + 1, 0);
+    for (size_t i = 0; i < items.size(); ++i) {
+        item_cell[i] = clamp_cell(items[i].position.y, lo.y, rows) * cols
+                     + clamp_cell(items[i].position.x, lo.x, cols);
+        ++cell_start[item_cell[i] + 1];
+    }
+    for (size_t c = 1; c < cell_start.size(); ++c)
+        cell_start[c] += cell_start[c - 1];
+
+    std::vector<size_t> cell_items(items.size());
+    {
+        std::vector<size_t> fill(cell_start.begin(), cell_start.end() - 1);
+        for (size_t i = 0; i < items.size(); ++i)
+            cell_items[fill[item_cell[i]]++] = i;
+    }
+
+    // Собиратели, упорядоченные по ячейке начала пути: соседние по пути собиратели попадают в одну задачу
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(gatherers.size());
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        if (IsStill(gatherers[g]))
+            continue;
+        const auto & p = gatherers[g].start_pos;
+        order.emplace_back(clamp_cell(p.y, lo.y, rows) * cols + clamp_cell(p.x, lo.x, cols), g);
+    }
+    std::sort(order.begin(), order.end());
+
+    const size_t tasks = (order.size() + GATHERERS_PER_TASK - 1) / GATHERERS_PER_TASK;
+    std::vector<std::vector<GatheringEvent>> task_events(tasks);
+
+    auto run_tasks = [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            auto & events = task_events[t];
+            const size_t last = std::min(order.size(), (t + 1) * GATHERERS_PER_TASK);
+
+            for (size_t k = t * GATHERERS_PER_TASK; k < last; ++k) {
+                const size_t g = order[k].second;
+                const auto & gatherer = gatherers[g];
+
+                const double reach = gatherer.width + max_item_width;
+                const glm::dvec2 from = MinPoint(gatherer.start_pos, gatherer.end_pos) - glm::dvec2{reach, reach};
+                const glm::dvec2 to   = MaxPoint(gatherer.start_pos, gatherer.end_pos) + glm::dvec2{reach, reach};
+                if (to.x < lo.x || to.y < lo.y || from.x > hi.x || from.y > hi.y)
+                    continue;
+
+                const size_t col_from = clamp_cell(from.x, lo.x, cols);
+                const size_t col_to   = clamp_cell(to.x,   lo.x, cols);
+                const size_t row_from = clamp_cell(from.y, lo.y, rows);
+                const size_t row_to   = clamp_cell(to.y,   lo.y, rows);
+
+                for (size_t row = row_from; row <= row_to; ++row) {
+                    for (size_t col = col_from; col <= col_to; ++col) {
+                        const size_t cell = row * cols + col;
+                        for (size_t n = cell_start[cell]; n < cell_start[cell + 1]; ++n) {
+                            const size_t i = cell_items[n];
+                            auto collect_result
+                                = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, items[i].position);
+
+                            if (collect_result.IsCollected(gatherer.width + items[i].width))
+                                events.push_back({.item_id = i,
+                                                  .gatherer_id = g,
+                                                  .sq_distance = collect_result.sq_distance,
+                                                  .time = collect_result.proj_ratio});
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    if (parallel_for)
+        parallel_for(tasks, run_tasks);
+    else
+        run_tasks(0, tasks);
+
+    std::vector<GatheringEvent> detected_events;
+    size_t total = 0;
+    for (const auto & events : task_events)
+        total += events.size();
+    detected_events.reserve(total);
+    for (auto & events : task_events)
+        detected_events.insert(detected_events.end(), events.begin(), events.end());
+
+    // Note: the full order makes the result independent of the task split
+    std::sort(detected_events.begin(), detected_events.end(), EventLess);
 
     return detected_events;
 }
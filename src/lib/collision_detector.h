@@ -3,6 +3,7 @@
 #include "glm_include.h"
 
 #include <algorithm>
+#include <functional>
 #include <vector>
 
 namespace collision_detector
@@ -56,6 +57,19 @@ struct GatheringEvent
     double time = 0;
 };
 
+// Events are ordered by time, ties by gatherer and item, so the order does not depend on how they were found
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+/*
+ *  То же, что FindGatherEvents, но предметы раскладываются по ячейкам сетки со стороной cell_size,
+ *  и собиратель проверяется только с предметами ячеек, которых касается его путь.
+ *  Собиратели делятся на группы по ячейке начала пути; группы проверяются независимо,
+ *  parallel_for может раздать их разным потокам. Результат совпадает с FindGatherEvents.
+ */
+using ParallelFor = std::function<void(size_t count, const std::function<void(size_t begin, size_t end)> & fn)>;
+
+std::vector<GatheringEvent> FindGatherEventsInGrid(const ItemGathererProvider& provider,
+                                                   double cell_size,
+                                                   const ParallelFor & parallel_for = {});
+
 }  // namespace collision_detector
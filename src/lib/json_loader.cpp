@@ -12,6 +12,17 @@ using namespace boost;
 namespace json_loader
 {
     
+std::optional<uint64_t> GetUint64(const json::value & value) noexcept
+{
+    if (const auto * pUint = value.if_uint64())
+        return *pUint;
+
+    if (const auto * pInt = value.if_int64(); pInt && *pInt >= 0)
+        return static_cast<uint64_t>(*pInt);
+
+    return std::nullopt;
+}
+
 static void LoadRoads(const json::array & roads, model::Map & gameMap)
 {
     for (const auto & itRoad : roads)
@@ -163,6 +174,12 @@ std::unique_ptr<model::Game> LoadGame(const fs::path & jsonPath)
             pGame->SetDogRetirementTime(dogRetirementTime);
         }
 
+        if (auto it = jsonRoot.as_object().find("maxPlayersPerSession"sv);
+            it != jsonRoot.as_object().end()) {
+            if (auto maxPlayers = GetUint64(it->value()); maxPlayers && *maxPlayers > 0)
+                pGame->SetMaxPlayersPerSession(*maxPlayers);
+        }
+
         if (const auto & maps = jsonRoot.at("maps"sv); maps.is_array())
         {
             for (const auto & it : maps.as_array())
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+
+#include <boost/json.hpp>
 
 #include "model.h"
 
@@ -9,4 +13,8 @@ namespace json_loader
 
 std::unique_ptr<model::Game> LoadGame(const std::filesystem::path & json_path);
 
+// Неотрицательное целое. Boost.JSON хранит такие числа как int64, если они помещаются;
+// отрицательные, дробные и нечисловые значения дают std::nullopt
+std::optional<uint64_t> GetUint64(const boost::json::value & value) noexcept;
+
 }  // namespace json_loader
@@ -21,4 +21,29 @@ unsigned LootGenerator::Generate(TimeInterval time_delta, unsigned loot_count,
     return generated_loot;
 }
 
+std::optional<LootGenerator::TimeInterval> LootGenerator::TimeUntilLoot(unsigned loot_count,
+                                                                         unsigned looter_count) const
+{
+    const unsigned loot_shortage = loot_count > looter_count ? 0u : looter_count - loot_count;
+    if (loot_shortage == 0 || probability_ <= 0.0)
+        return std::nullopt;
+
+    if (!predictable_ || probability_ >= 1.0)
+        return TimeInterval::zero();
+
+    // round(shortage * (1 - (1 - p)^ratio)) > 0  <=>  (1 - p)^ratio <= 1 - 0.5 / shortage
+    const double ratio = std::log(1.0 - 0.5 / loot_shortage) / std::log(1.0 - probability_);
+    const double due_ms = ratio * std::chrono::duration<double, std::milli>{base_interval_}.count();
+
+    // Note: practically never, but the caller may still add it to a time point
+    constexpr double MAX_DUE_MS = 1e15;
+    if (!std::isfinite(due_ms) || due_ms > MAX_DUE_MS)
+        return TimeInterval{static_cast<TimeInterval::rep>(MAX_DUE_MS)};
+
+    // Note: a unit earlier, so that rounding never postpones the loot
+    const TimeInterval due{static_cast<TimeInterval::rep>(std::floor(due_ms)) - 1};
+
+    return std::max(due - time_without_loot_, TimeInterval::zero());
+}
+
 } // namespace loot_gen
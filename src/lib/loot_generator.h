@@ -50,8 +50,15 @@ public:
      * probability - вероятность появления трофея в течение базового интервала времени
      * random_generator - генератор псевдослучайных чисел в диапазоне от [0 до 1]
      */
+    LootGenerator(TimeInterval base_interval, double probability)
+        : base_interval_{base_interval}
+        , probability_{probability}
+        , random_generator_{DefaultGenerator}
+        , predictable_{true} {
+    }
+
     LootGenerator(TimeInterval base_interval, double probability,
-                  RandomGenerator random_gen = DefaultGenerator)
+                  RandomGenerator random_gen)
         : base_interval_{base_interval}
         , probability_{probability}
         , random_generator_{std::move(random_gen)} {
@@ -68,6 +75,15 @@ public:
      */
     unsigned Generate(TimeInterval time_delta, unsigned loot_count, unsigned looter_count);
 
+    /*
+     * Возвращает время, которое должно пройти, чтобы Generate вернул ненулевое количество
+     * трофеев при тех же loot_count и looter_count. Пока оно не прошло, вызов Generate можно
+     * отложить и передать ему всё накопленное время разом - результат будет тем же.
+     * std::nullopt - трофеи не появятся, пока не изменится их нехватка.
+     * С пользовательским random_generator время непредсказуемо, возвращается 0.
+     */
+    [[nodiscard]] std::optional<TimeInterval> TimeUntilLoot(unsigned loot_count, unsigned looter_count) const;
+
 private:
     static double DefaultGenerator() noexcept {
         return 1.0;
@@ -77,6 +93,7 @@ private:
     double probability_;
     TimeInterval time_without_loot_{};
     RandomGenerator random_generator_;
+    bool predictable_ = false;
 };
 
 }  // namespace loot_gen
@@ -1,5 +1,7 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 
@@ -39,21 +41,17 @@ private:
         return ret;
     }
     [[nodiscard]] size_t GatherersCount() const override {
-        return session_.GetDogs().size();
+        return session_.GetDogMoves().size();
     }
     [[nodiscard]] cd::Gatherer GetGatherer(size_t idx) const override {
         cd::Gatherer ret = { };
 
         if (idx < GatherersCount()) {
-            const auto & dog = session_.GetDogs().at(idx);
+            const auto & move = session_.GetDogMoves()[idx];
 
-            ret.end_pos = dog->GetPosition();
-            if (auto start_pos = dog->GetPrevPosition(); start_pos)
-                ret.start_pos = *start_pos;
-            else
-                ret.start_pos = ret.end_pos;
-
-            ret.width = 0.6;
+            ret.start_pos = move.start;
+            ret.end_pos   = move.end;
+            ret.width     = 0.6;
         }
 
         return ret;
@@ -185,34 +183,96 @@ std::optional<glm::dvec2> Map::BoundedMove(const glm::dvec2 &origin, const glm::
     return most_far;
 }
 
-glm::dvec2 Map::GenerateRandomPositionOnRoad() const
+void Map::BuildRoadSampler()
+{
+    if (roads_.empty()) {
+        road_sampler_ = {};
+        road_area_prefix_.clear();
+        return;
+    }
+
+    // Note: weight is the road area, so every point of the roads is equally likely
+    std::vector<double> weights;
+    weights.reserve(roads_.size());
+    for (const auto & road : roads_) {
+        auto [lb, rt] = road.GetBounds();
+        weights.push_back(static_cast<double>(rt.x - lb.x) * static_cast<double>(rt.y - lb.y));
+    }
+
+    road_area_prefix_.assign(1, 0.0);
+    for (double w : weights)
+        road_area_prefix_.push_back(road_area_prefix_.back() + w);
+
+    road_sampler_ = util::AliasTable(weights);
+}
+
+glm::dvec2 Map::GenerateRandomPositionOnRoad(util::Xoshiro256 & rng) const
 {
     glm::dvec2 pos(0);
 
     if (!roads_.empty()) {
-        std::random_device rd;
-        std::mt19937 mt(rd());
+        // Note: a map outside of Game has no sampler, pick a road uniformly then
+        size_t idxRoad = road_sampler_.Size() == roads_.size() ? road_sampler_.Sample(rng)
+                                                                : static_cast<size_t>(rng.NextIndex(roads_.size()));
+
+        const auto & road = roads_[idxRoad];
+        auto [lb, rt] = road.GetBounds();
 
-        std::uniform_int_distribution<size_t> dist(0, roads_.size() - 1);
-        size_t idxRoad = dist(mt);
+        pos.x = lb.x + (rt.x - lb.x) * rng.NextDouble();
+        pos.y = lb.y + (rt.y - lb.y) * rng.NextDouble();
+    }
+
+    return pos;
+}
+
+void Map::GenerateSpreadPositionsOnRoads(util::Xoshiro256 & rng, size_t n, std::vector<glm::dvec2> & out) const
+{
+    if (road_area_prefix_.size() != roads_.size() + 1 || roads_.empty()) {
+        for (size_t i = 0; i < n; ++i)
+            out.push_back(GenerateRandomPositionOnRoad(rng));
+        return;
+    }
+
+    const size_t first = out.size();
+    const double total = road_area_prefix_.back();
+
+    // Note: one point per equal share of the road area, neighbours in a batch never pile up
+    for (size_t i = 0; i < n; ++i) {
+        const double u = (static_cast<double>(i) + rng.NextDouble()) * total / static_cast<double>(n);
+
+        auto it = std::upper_bound(road_area_prefix_.begin() + 1, road_area_prefix_.end(), u);
+        const size_t idxRoad = std::min(static_cast<size_t>(it - road_area_prefix_.begin()) - 1, roads_.size() - 1);
 
         const auto & road = roads_[idxRoad];
-        auto bounds = road.GetBounds();
+        auto [lb, rt] = road.GetBounds();
 
-        std::uniform_real_distribution<float> distBoundX(bounds.first.x, bounds.second.x);
-        std::uniform_real_distribution<float> distBoundY(bounds.first.y, bounds.second.y);
+        const double area  = road_area_prefix_[idxRoad + 1] - road_area_prefix_[idxRoad];
+        const double along = area > 0 ? std::clamp((u - road_area_prefix_[idxRoad]) / area, 0.0, 1.0) : rng.NextDouble();
+        const double across = rng.NextDouble();
 
-        pos.x = distBoundX(mt);
-        pos.y = distBoundY(mt);
+        glm::dvec2 pos;
+        if (road.IsHorizontal()) {
+            pos.x = lb.x + (rt.x - lb.x) * along;
+            pos.y = lb.y + (rt.y - lb.y) * across;
+        }
+        else {
+            pos.x = lb.x + (rt.x - lb.x) * across;
+            pos.y = lb.y + (rt.y - lb.y) * along;
+        }
+        out.push_back(pos);
     }
 
-    return pos;
+    // Note: shuffled, otherwise consecutive joins would walk along the roads
+    for (size_t i = out.size() - 1; i > first; --i)
+        std::swap(out[i], out[first + static_cast<size_t>(rng.NextIndex(i - first + 1))]);
 }
 
 
-GameSession::GameSession(Map & map, const loot_gen::LootGeneratorConfig & cfg, double dogRetirementTime)
+GameSession::GameSession(Map & map, const loot_gen::LootGeneratorConfig & cfg, double dogRetirementTime,
+                         uint64_t seed)
            : map_(map)
            , dogRetirementTime_(dogRetirementTime)
+           , random_(seed)
 {
     static Id s_id = 0;
     id_ = ++s_id;
@@ -231,41 +291,242 @@ const Map::Id &GameSession::GetMapIp() const noexcept
 
 Dog & GameSession::AddNewDog()
 {
-    auto pDog = std::make_unique<Dog>();
-    auto id = pDog->GetId();
-    auto & dog = *pDog;
+    std::unique_ptr<Dog> pDog;
+
+    if (!free_dogs_.empty()) {
+        pDog = std::move(free_dogs_.back());
+        free_dogs_.pop_back();
+        *pDog = Dog();      // Note: a recycled object gets a new id, ids are never reused
+    }
+    else
+        pDog = std::make_unique<Dog>();
 
+    pDog->slot_ = dogs_.size();
     dogs_.push_back(std::move(pDog));
 
     return *dogs_.back();
 }
 
+void GameSession::RemoveDog(Dog & dog)
+{
+    const size_t slot = dog.slot_;
+    auto pDog = std::move(dogs_[slot]);
+
+    // Note: swap-and-pop, the last dog takes the slot of the removed one
+    if (slot + 1 != dogs_.size()) {
+        dogs_[slot] = std::move(dogs_.back());
+        dogs_[slot]->slot_ = slot;
+    }
+    dogs_.pop_back();
+
+    // Note: paths of the last tick may point to the removed dog
+    std::erase_if(dog_moves_, [pDog = pDog.get()](const DogMove & m) {
+        return m.dog == pDog;
+    });
+
+    if (free_dogs_.size() < MAX_FREE_DOGS) {
+        pDog->gathered_items_.clear();
+        free_dogs_.push_back(std::move(pDog));
+    }
+}
+
+glm::dvec2 GameSession::TakeSpawnPoint()
+{
+    spawn_pool_used_ = true;
+    if (spawn_pool_.empty())
+        RefillSpawnPool();
+
+    const auto pos = spawn_pool_.back();
+    spawn_pool_.pop_back();
+
+    return pos;
+}
+
+void GameSession::RefillSpawnPool()
+{
+    map_.GenerateSpreadPositionsOnRoads(random_, SPAWN_POOL_SIZE - spawn_pool_.size(), spawn_pool_);
+}
+
 void GameSession::Think(int64_t elapsedMs)
 {
-    size_t numLoots = pLootGenerator_->Generate(LootGenerator::TimeInterval(elapsedMs),
-                                                lootInstances_.size(),
-                                               dogs_.size());
+    BeginThink(elapsedMs);
+    while (!ThinkStep()) {
+    }
+}
+
+void GameSession::BeginThink(int64_t elapsedMs)
+{
+    think_phase_      = ThinkPhase::Move;
+    think_cursor_     = 0;
+    think_elapsed_ms_ = elapsedMs;
+
+    dog_moves_.clear();
+}
+
+bool GameSession::ThinkStep()
+{
+    switch (think_phase_) {
+    case ThinkPhase::Move:
+        // Note: a step with the pool moves a chunk per thread, so it takes about as long as without it
+        if (MoveDogs(think_elapsed_ms_, MOVE_CHUNK * (pool_ ? pool_->GetConcurrency() : 1)))
+            think_phase_ = ThinkPhase::Loot;
+        break;
+
+    case ThinkPhase::Loot:
+        SpawnLoots(think_elapsed_ms_);
+
+        // Note: the pool is topped up between joins, so a join storm rarely has to generate points
+        if (spawn_pool_used_ && spawn_pool_.size() < SPAWN_POOL_SIZE / 2)
+            RefillSpawnPool();
+
+        think_phase_ = ThinkPhase::Collect;
+        break;
+
+    // Note: All players finish moving - try collect loots
+    case ThinkPhase::Collect:
+        if (!dog_moves_.empty())
+            TryCollectLoots();
+        think_phase_ = ThinkPhase::Store;
+        break;
+
+    case ThinkPhase::Store:
+        if (!dog_moves_.empty())
+            TryStoreLootsAtOffices();
+        think_phase_ = ThinkPhase::Retire;
+        break;
+
+    case ThinkPhase::Retire:
+        game_time_ms_ += think_elapsed_ms_;
+        retirement_wheel_.Advance(static_cast<uint64_t>(game_time_ms_), [this](Player * player) {
+            player->OnRetired();
+            retired_players_.push_back(player);
+        });
+        think_phase_ = ThinkPhase::Done;
+        break;
+
+    case ThinkPhase::Done:
+        break;
+    }
+
+    return think_phase_ == ThinkPhase::Done;
+}
+
+bool GameSession::MoveDogs(int64_t elapsedMs, size_t maxPlayers)
+{
+    // Note: the active set can't change until the pass is over, players join with stopped dogs
+    const size_t begin = think_cursor_;
+    const size_t end = std::min(active_players_.size(), think_cursor_ + maxPlayers);
+
+    // Игрок двигает только свою собаку и читает неизменяемую карту, поэтому части обрабатываются параллельно.
+    // Путь собаки пишется по её индексу, порядок путей тот же, что и без пула
+    dog_moves_.resize(end);
+    auto move = [this, begin, elapsedMs](size_t from, size_t to) {
+        for (size_t i = begin + from; i < begin + to; ++i) {
+            Player * player = active_players_[i];
+            const auto start = player->GetPosition();
+            player->Think(elapsedMs);
+            dog_moves_[i] = DogMove{player->GetDog(), start, player->GetPosition()};
+        }
+    };
+
+    if (pool_ && end - begin >= PARALLEL_MIN_MOVES)
+        pool_->ParallelFor(end - begin, move);
+    else
+        move(0, end - begin);
+    think_cursor_ = end;
+
+    if (think_cursor_ < active_players_.size())
+        return false;
+
+    // Note: dogs stopped by the map leave the active set after the pass
+    for (size_t i = 0; i < active_players_.size(); ) {
+        Player * player = active_players_[i];
+        if (player->IsStopped())
+            player->UpdateMotion();     // swaps the last one into i
+        else
+            ++i;
+    }
+
+    return true;
+}
+
+void GameSession::AddPlayer(Player & player)
+{
+    player.session_index_ = players_.size();
+    players_.push_back(&player);
+}
+
+void GameSession::RemovePlayer(Player & player)
+{
+    const size_t idx = player.session_index_;
+    Player * last = players_.back();
+
+    players_[idx] = last;
+    last->session_index_ = idx;
+    players_.pop_back();
+}
+
+void GameSession::ActivatePlayer(Player & player)
+{
+    player.active_index_ = active_players_.size();
+    active_players_.push_back(&player);
+}
+
+void GameSession::DeactivatePlayer(Player & player)
+{
+    const size_t idx = player.active_index_;
+    Player * last = active_players_.back();
+
+    active_players_[idx] = last;
+    last->active_index_ = idx;
+    active_players_.pop_back();
+
+    player.active_index_ = Player::NOT_ACTIVE;
+}
+
+void GameSession::SpawnLoots(int64_t elapsedMs)
+{
+    loot_pending_ms_ += elapsedMs;
+
+    const auto lootCount   = static_cast<unsigned>(lootInstances_.size());
+    const auto looterCount = static_cast<unsigned>(dogs_.size());
+
+    if (!loot_wait_valid_ || loot_wait_key_ != std::make_pair(lootCount, looterCount)) {
+        loot_wait_       = pLootGenerator_->TimeUntilLoot(lootCount, looterCount);
+        loot_wait_key_   = { lootCount, looterCount };
+        loot_wait_valid_ = true;
+    }
+
+    // Note: nothing can spawn yet, the time is handed to the generator later in one piece
+    if (!loot_wait_ || loot_pending_ms_ < loot_wait_->count())
+        return;
+
+    size_t numLoots = pLootGenerator_->Generate(LootGenerator::TimeInterval(loot_pending_ms_),
+                                                lootCount,
+                                                looterCount);
+    loot_pending_ms_ = 0;
+    loot_wait_valid_ = false;
+
     if (numLoots > 0 && !map_.GetLootTypes().empty()) {
-        std::random_device rd;
-        std::mt19937 mt(rd());
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, map_.GetLootTypes().size() - 1);
+        const size_t numTypes = map_.GetLootTypes().size();
 
         static LootInstance::Id s_id = 0;
 
         for (size_t n = 0; n < numLoots; ++n) {
             auto pLoot = std::make_shared<LootInstance>();
             pLoot->id = ++s_id;
-            pLoot->type = static_cast<int>(dist(mt));
-            pLoot->pos = map_.GenerateRandomPositionOnRoad();
+            pLoot->type = static_cast<int>(random_.NextIndex(numTypes));
+            pLoot->pos = GenerateRandomPositionOnRoad();
 
             lootInstances_.push_back(std::move(pLoot));
         }
     }
+}
 
-    // Note: All players finish moving - try collect loots
-    TryCollectLoots();
-
-    TryStoreLootsAtOffices();
+GameSession::RetirementWheel::Handle GameSession::ScheduleRetirement(Player & player)
+{
+    const auto retirement_ms = std::llround(GetDogRetirementTime() * 1000.0);
+    return retirement_wheel_.Insert(&player, static_cast<uint64_t>(game_time_ms_ + retirement_ms));
 }
 
 void GameSession::TryCollectLoots()
@@ -276,8 +537,9 @@ void GameSession::TryCollectLoots()
 
     bool anyGathered = false;
 
-    for (const auto & ge : cd::FindGatherEvents(*this)) {
-        const auto & dog = dogs_[ge.gatherer_id];
+    // Note: events come in a fixed order, so the loot goes to the same dog however the search was split
+    for (const auto & ge : cd::FindGatherEventsInGrid(*this, GATHER_GRID_CELL, GetParallelFor())) {
+        Dog * dog = dog_moves_[ge.gatherer_id].dog;
         const auto & itm = lootInstances_[ge.item_id];
 
         if (dog->GatherItem(itm, bagCapacity))
@@ -301,12 +563,22 @@ void GameSession::TryStoreLootsAtOffices()
 {
     CMapItemGathererProvider provider(*this);
 
-    for (const auto & ge : cd::FindGatherEvents(*this)) {
-        const auto & dog = dogs_[ge.gatherer_id];
+    for (const auto & ge : cd::FindGatherEventsInGrid(provider, GATHER_GRID_CELL, GetParallelFor())) {
+        Dog * dog = dog_moves_[ge.gatherer_id].dog;
         dog->StoreLootsAtOffice(map_.GetLootTypes());
     }
 }
 
+cd::ParallelFor GameSession::GetParallelFor() const
+{
+    if (!pool_ || dog_moves_.size() < PARALLEL_MIN_MOVES)
+        return {};
+
+    return [pool = pool_](size_t count, const util::ThreadPool::RangeFn & fn) {
+        pool->ParallelFor(count, fn);
+    };
+}
+
 cd::Item GameSession::GetItem(size_t idx) const
 {
     cd::Item ret = { };
@@ -321,16 +593,12 @@ cd::Item GameSession::GetItem(size_t idx) const
 cd::Gatherer GameSession::GetGatherer(size_t idx) const
 {
     cd::Gatherer ret = { };
-    if (idx < dogs_.size()) {
-        const auto & dog = dogs_[idx];
-
-        ret.end_pos = dog->GetPosition();
-        if (const auto & start_pos = dog->GetPrevPosition(); start_pos)
-            ret.start_pos = *start_pos;
-        else
-            ret.start_pos = ret.end_pos;
+    if (idx < dog_moves_.size()) {
+        const auto & move = dog_moves_[idx];
 
-        ret.width = 0.6;
+        ret.start_pos = move.start;
+        ret.end_pos   = move.end;
+        ret.width     = 0.6;
     }
 
     return ret;
@@ -342,36 +610,88 @@ Player * PlayerTokens::CreatePlayer(std::string_view user_name, GameSession & se
     auto p = std::make_unique<Player>(user_name, generate(), session, dog);
     auto pRet = p.get();
 
-    token_to_player_[p->GetToken()] = std::move(p);
+    Token token = p->GetToken();
+    PlayerRoute route{session.GetId(), p->GetId()};
+    Shard & shard = GetShard(token);
+
+    std::unique_lock lock(shard.mutex);
+    shard.token_to_player.insert_or_assign(std::move(token), Entry{std::move(p), route});
 
     return pRet;
 }
 
 Player *PlayerTokens::Find(const Token &t) const
 {
-    auto it = token_to_player_.find(t);
-    return it != token_to_player_.end() ? it->second.get() : nullptr;
+    const auto & map = GetShard(t).token_to_player;
+
+    auto it = map.find(t);
+    return it != map.end() ? it->second.player.get() : nullptr;
 }
 
 bool PlayerTokens::Remove(const Token &t)
 {
-    auto res = token_to_player_.erase(t);
-    return res > 0;
+    Shard & shard = GetShard(t);
+
+    Token2Player::node_type node;
+    {
+        std::unique_lock lock(shard.mutex);
+        node = shard.token_to_player.extract(t);
+    }
+
+    // Note: the player is destroyed outside of the lock, readers have no pointers to it
+    return !node.empty();
+}
+
+std::optional<PlayerRoute> PlayerTokens::FindRoute(const Token &t) const
+{
+    const Shard & shard = GetShard(t);
+
+    std::shared_lock lock(shard.mutex);
+
+    if (auto it = shard.token_to_player.find(t); it != shard.token_to_player.end())
+        return it->second.route;
+
+    return std::nullopt;
+}
+
+void PlayerTokens::Reserve(size_t extra)
+{
+    // Note: tokens are random, so they spread evenly over the shards
+    const size_t per_shard = extra / SHARDS_COUNT + 1;
+
+    for (auto & shard : shards_) {
+        std::unique_lock lock(shard.mutex);
+        shard.token_to_player.reserve(shard.token_to_player.size() + per_shard);
+    }
 }
 
 void PlayerTokens::ForEachPlayerOnMap(const Map::Id &mapId, const PlayerVisitor& pv) const
 {
-    for (const auto & p : token_to_player_)
-    {
-        if (p.second->GetAssignedMapId() == mapId)
-            pv(*p.second);
+    for (const auto & shard : shards_) {
+        for (const auto & p : shard.token_to_player)
+        {
+            if (p.second.player->GetAssignedMapId() == mapId)
+                pv(*p.second.player);
+        }
     }
 }
 
 void PlayerTokens::ForEachPlayer(const PlayerVisitor& pv) const
 {
-    for (const auto & p : token_to_player_)
-        pv(*p.second);
+    for (const auto & shard : shards_) {
+        for (const auto & p : shard.token_to_player)
+            pv(*p.second.player);
+    }
+}
+
+PlayerTokens::Shard & PlayerTokens::GetShard(const Token &t) noexcept
+{
+    return shards_[std::hash<Token>{}(t) % SHARDS_COUNT];
+}
+
+const PlayerTokens::Shard & PlayerTokens::GetShard(const Token &t) const noexcept
+{
+    return shards_[std::hash<Token>{}(t) % SHARDS_COUNT];
 }
 
 Player * Players::CreatePlayer(std::string_view user_name, GameSession & session, Dog & dog)
@@ -400,6 +720,8 @@ void Game::AddMap(Map && map)
     {
         try
         {
+            // Note: roads are complete once the map is added, spawn sampling is prepared here
+            map.BuildRoadSampler();
             maps_.push_back(std::move(map));
         }
         catch (...)
@@ -437,16 +759,35 @@ Player * Game::Join(std::string_view userName, const model::Map::Id & mapId)
 Player * Game::Join(std::string_view user_name, Map & map)
 {
     auto & session = GetOrCreateSession(map);
+    WakeSession(session);
+
     auto & dog = session.AddNewDog();
+    PlaceNewDog(session, dog);
 
+    return players_.CreatePlayer(user_name, session, dog);
+}
+
+std::vector<Player *> Game::JoinMany(const std::vector<std::string> & userNames, Map & map)
+{
+    std::vector<Player *> ret;
+    ret.reserve(userNames.size());
+    players_.Reserve(userNames.size());
+
+    // Note: a shard may fill up in the middle of the batch, so the session is chosen per player
+    for (const auto & name : userNames)
+        ret.push_back(Join(name, map));
+
+    return ret;
+}
+
+void Game::PlaceNewDog(GameSession & session, Dog & dog) const
+{
     if (randomize_spawn_points_)
-        dog.SetPosition(map.GenerateRandomPositionOnRoad());
-    else if (!map.GetRoads().empty()) {
-        auto start = map.GetRoads().front().GetStart();
+        dog.SetPosition(session.TakeSpawnPoint());
+    else if (const auto & roads = session.GetMap().GetRoads(); !roads.empty()) {
+        auto start = roads.front().GetStart();
         dog.SetPosition({ start.x, start.y });
     }
-
-    return players_.CreatePlayer(user_name, session, dog);
 }
 
 Player * Game::FindPlayerByToken(const Token & t) const
@@ -456,44 +797,143 @@ Player * Game::FindPlayerByToken(const Token & t) const
 
 bool Game::RemovePlayerByToken(const Token & t)
 {
-    return players_.RemoveByToken(t);
+    auto pPlayer = players_.FindByToken(t);
+    if (!pPlayer)
+        return false;
+
+    auto & session = pPlayer->GetGameSession();
+    players_.RemoveByToken(t);
+
+    if (session.GetPlayersCount() == 0)
+        HibernateSession(session);
+
+    return true;
 }
 
 Game::RetiredPlayers Game::Think(int64_t elapsedMs)
 {
-    RetiredPlayers ret;
-    auto tpNow = Clock::now();
-    // Note: Update player moving
-    players_.ForEachPlayer([&](Player & player) {
-        player.Think(elapsedMs);
+    BeginTick(elapsedMs);
+    StepTick(TimePoint::max());
 
-        if (player.IsRetired())
-            ret.push_back(&player.GetToken());
-    });
+    return TakeRetiredPlayers();
+}
 
-    for (auto & s : sessions_)
-        s.second->Think(elapsedMs);
+void Game::BeginTick(int64_t elapsedMs)
+{
+    // Note: every session moves only its active dogs, idle players cost nothing
+    tick_sessions_   = awake_sessions_;
+    tick_index_      = 0;
+    tick_elapsed_ms_ = elapsedMs;
+    tick_running_    = true;
+
+    if (!tick_sessions_.empty())
+        tick_sessions_.front()->BeginThink(elapsedMs);
+}
 
-    return ret;
+bool Game::StepTick(TimePoint deadline)
+{
+    if (!tick_running_)
+        return true;
+
+    // Note: at least one step is done per call, so the tick always makes progress
+    do {
+        if (tick_index_ == tick_sessions_.size()) {
+            game_time_ms_ += tick_elapsed_ms_;
+            reclaim_wheel_.Advance(static_cast<uint64_t>(game_time_ms_), [this](GameSession::Id id) {
+                if (auto it = sessions_.find(id); it != sessions_.end()) {
+                    auto & shards = map_sessions_[it->second->GetMapIp()];
+                    std::erase(shards, it->second.get());
+                    if (shards.empty())
+                        map_sessions_.erase(it->second->GetMapIp());
+
+                    sessions_.erase(it);
+                }
+            });
+
+            tick_sessions_.clear();
+            tick_running_ = false;
+            return true;
+        }
+
+        GameSession * s = tick_sessions_[tick_index_];
+        if (s->ThinkStep()) {
+            for (Player * player : s->TakeRetiredPlayers())
+                tick_retired_.push_back(&player->GetToken());
+
+            if (++tick_index_ < tick_sessions_.size())
+                tick_sessions_[tick_index_]->BeginThink(tick_elapsed_ms_);
+        }
+    } while (deadline == TimePoint::max() || Clock::now() < deadline);
+
+    return false;
+}
+
+void Game::WakeSession(GameSession & session)
+{
+    if (session.reclaim_) {
+        reclaim_wheel_.Remove(*session.reclaim_);
+        session.reclaim_.reset();
+    }
+
+    if (session.awake_index_ == GameSession::NOT_AWAKE) {
+        session.awake_index_ = awake_sessions_.size();
+        awake_sessions_.push_back(&session);
+    }
+}
+
+void Game::HibernateSession(GameSession & session)
+{
+    if (const size_t idx = session.awake_index_; idx != GameSession::NOT_AWAKE) {
+        GameSession * last = awake_sessions_.back();
+        awake_sessions_[idx] = last;
+        last->awake_index_ = idx;
+        awake_sessions_.pop_back();
+
+        session.awake_index_ = GameSession::NOT_AWAKE;
+    }
+
+    // Note: the session and its loot live a little longer, players often come back soon
+    if (!session.reclaim_)
+        session.reclaim_ = reclaim_wheel_.Insert(session.GetId(),
+                                                 static_cast<uint64_t>(game_time_ms_ + session_grace_period_ms_));
 }
 
 GameSession &Game::GetOrCreateSession(Map &map)
 {
-    for (const auto & it : sessions_)
-    {
-        if (it.second->GetMapIp() == map.GetId())
-            return *it.second;
+    auto & shards = map_sessions_[map.GetId()];
+
+    // Note: a map has a handful of shards, the least loaded one takes the player
+    GameSession * pLeast = nullptr;
+    for (GameSession * s : shards) {
+        if (!pLeast || s->GetPlayersCount() < pLeast->GetPlayersCount())
+            pLeast = s;
     }
 
+    if (pLeast && (max_players_per_session_ == 0 || pLeast->GetPlayersCount() < max_players_per_session_))
+        return *pLeast;
+
+    // Note: sessions are seeded in creation order, the same seed and joins give the same game
     auto pNewSession = std::make_unique<GameSession>(map,
-                                                                          GetLootGeneratorConfig(),
-                                                                          GetDogRetirementTime());
+                                                     GetLootGeneratorConfig(),
+                                                     GetDogRetirementTime(),
+                                                     random_seed_ + sessions_created_++);
     auto pRet = pNewSession.get();
+    pRet->SetThreadPool(sim_pool_.get());
     sessions_[pNewSession->GetId()] = std::move(pNewSession);
+    shards.push_back(pRet);
 
     return *pRet;
 }
 
+void Game::SetSimulationThreads(size_t threads)
+{
+    auto pool = threads > 1 ? std::make_unique<util::ThreadPool>(threads - 1) : nullptr;
+    for (auto & [id, session] : sessions_)
+        session->SetThreadPool(pool.get());
+
+    sim_pool_ = std::move(pool);
+}
+
 
 Player::Player(std::string_view user_name, Token token, GameSession & session, Dog & dog)
       : user_name_(user_name)
@@ -503,6 +943,25 @@ Player::Player(std::string_view user_name, Token token, GameSession & session, D
 {
     static Id s_id_players = 0;
     id_ = s_id_players++;
+
+    session_.AddPlayer(*this);
+    join_time_ms_ = session_.GetGameTimeMs();
+
+    // Note: a new dog stands still, idle time counts from joining
+    UpdateMotion();
+}
+
+Player::~Player()
+{
+    if (retirement_)
+        session_.CancelRetirement(*retirement_);
+
+    if (active_index_ != NOT_ACTIVE)
+        session_.DeactivatePlayer(*this);
+
+    // Note: the dog belongs to the player, it leaves the session together with it
+    session_.RemoveDog(dog_);
+    session_.RemovePlayer(*this);
 }
 
 glm::dvec2 Player::GetPosition() const noexcept
@@ -531,21 +990,33 @@ void Player::Think(int64_t elapsedMs)
         glm::any(epsilonNotEqual(vec2(*newPos), vec2(estimatedNewPos), vec2(FLT_EPSILON)))) {
         dog_.SetDirectionCode(""sv, 0);     // Note: Stop dog
     }
+}
 
-    playing_time_ms_ += elapsedMs;
-    stopped_time_ms_ = IsStopped() ? stopped_time_ms_ + elapsedMs : 0;
+void Player::SetDirection(std::string_view d, float speed)
+{
+    dog_.SetDirectionCode(d, speed);
+
+    UpdateMotion();
 }
 
-bool Player::IsRetired() const
+void Player::UpdateMotion()
 {
-    bool bRet = false;
-    if (IsStopped()) {
-        //static_cast<double>(stopped_time_ms_) / 1000.0 >= session_.GetRe
+    const bool stopped = IsStopped();
 
+    if (stopped && active_index_ != NOT_ACTIVE)
+        session_.DeactivatePlayer(*this);
+    else if (!stopped && active_index_ == NOT_ACTIVE)
+        session_.ActivatePlayer(*this);
 
-    }
+    if (retired_)
+        return;
 
-    return bRet;
+    if (stopped && !retirement_)
+        retirement_ = session_.ScheduleRetirement(*this);
+    else if (!stopped && retirement_) {
+        session_.CancelRetirement(*retirement_);
+        retirement_.reset();
+    }
 }
 
 
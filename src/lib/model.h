@@ -1,17 +1,24 @@
 #pragma once
 
+#include <array>
+#include <mutex>
 #include <random>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <filesystem>
 #include <functional>
 #include <optional>
+#include <utility>
 
 #include "tagged.h"
 #include "glm_include.h"
 #include "loot_generator.h"
 #include "collision_detector.h"
+#include "timing_wheel.h"
+#include "thread_pool.h"
+#include "random.h"
 
 
 namespace model
@@ -215,6 +222,10 @@ private:
     LootInstances gathered_items_;
     int score_ = 0;
     TimePoint creation_time_ = Clock::now();
+
+    // Note: place in GameSession::dogs_, maintained by the session
+    friend class GameSession;
+    size_t slot_ = 0;
 };
 
 
@@ -286,7 +297,13 @@ public:
 
     std::optional<glm::dvec2> BoundedMove(const glm::dvec2 & origin, const glm::dvec2 & newPos) const;
 
-    glm::dvec2 GenerateRandomPositionOnRoad() const;
+    // Prepares length-weighted road sampling, called by Game::AddMap
+    void BuildRoadSampler();
+
+    glm::dvec2 GenerateRandomPositionOnRoad(util::Xoshiro256 & rng) const;
+
+    // Appends n positions evenly spread over the roads (stratified by road area), in random order
+    void GenerateSpreadPositionsOnRoads(util::Xoshiro256 & rng, size_t n, std::vector<glm::dvec2> & out) const;
 
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
@@ -302,9 +319,15 @@ private:
     std::optional<size_t> bagCapacity_ = std::nullopt;
 
     LootTypes lootTypes_;
+    util::AliasTable road_sampler_;
+    // Note: running total of road areas, road i covers [road_area_prefix_[i], road_area_prefix_[i + 1])
+    std::vector<double> road_area_prefix_;
 };
 
 
+class Player;
+
+
 class GameSession : public collision_detector::ItemGathererProvider
 {
     using Dogs             = std::vector<std::unique_ptr<Dog> >;
@@ -312,9 +335,21 @@ class GameSession : public collision_detector::ItemGathererProvider
 
 public:
 
-    using Id = std::uint64_t;
+    using Id              = std::uint64_t;
+    using RetirementWheel = util::TimingWheel<Player *>;
+    using RetiredPlayers  = std::vector<Player *>;
 
-    GameSession(Map & map, const loot_gen::LootGeneratorConfig & cfg, double dogRetirementTime);
+    // Path of a dog during the current tick
+    struct DogMove
+    {
+        Dog * dog = nullptr;
+        glm::dvec2 start;
+        glm::dvec2 end;
+    };
+    using DogMoves = std::vector<DogMove>;
+
+    GameSession(Map & map, const loot_gen::LootGeneratorConfig & cfg, double dogRetirementTime,
+                uint64_t seed);
 
     [[nodiscard]] Id GetId() const noexcept {
         return id_;
@@ -332,40 +367,165 @@ public:
 
     Dog & AddNewDog();
 
+    // Called when the owner of the dog leaves the game
+    void RemoveDog(Dog & dog);
+
+    [[nodiscard]] glm::dvec2 GenerateRandomPositionOnRoad() {
+        return map_.GenerateRandomPositionOnRoad(random_);
+    }
+
+    // Spawn point for a joining dog, taken from the precomputed pool
+    [[nodiscard]] glm::dvec2 TakeSpawnPoint();
+
     const auto & GetDogs() const noexcept {
         return dogs_;
     }
 
     void Think(int64_t elapsedMs);
 
+    // Resumable tick: BeginThink, then ThinkStep until it returns true.
+    // A step is bounded - a chunk of moving dogs or one phase of the tick
+    void BeginThink(int64_t elapsedMs);
+    bool ThinkStep();
+
+    // Dogs moved during the last tick, only they take part in collisions
+    [[nodiscard]] const DogMoves & GetDogMoves() const noexcept {
+        return dog_moves_;
+    }
+
+    // Active set - players whose dogs are moving
+    void ActivatePlayer(Player & player);
+    void DeactivatePlayer(Player & player);
+
+    [[nodiscard]] size_t GetActivePlayersCount() const noexcept {
+        return active_players_.size();
+    }
+
+    void AddPlayer(Player & player);
+    void RemovePlayer(Player & player);
+
+    [[nodiscard]] const std::vector<Player *> & GetPlayers() const noexcept {
+        return players_;
+    }
+
+    [[nodiscard]] size_t GetPlayersCount() const noexcept {
+        return players_.size();
+    }
+
+    // Hibernating session is not ticked and will be freed unless somebody joins
+    [[nodiscard]] bool IsHibernating() const noexcept {
+        return awake_index_ == NOT_AWAKE;
+    }
+
+    [[nodiscard]] int64_t GetGameTimeMs() const noexcept {
+        return game_time_ms_;
+    }
+
+    // Player's dog stands still since the current game time
+    RetirementWheel::Handle ScheduleRetirement(Player & player);
+
+    void CancelRetirement(RetirementWheel::Handle h) {
+        retirement_wheel_.Remove(h);
+    }
+
+    // Players retired since the previous call
+    [[nodiscard]] RetiredPlayers TakeRetiredPlayers() {
+        return std::exchange(retired_players_, {});
+    }
+
+    // nullptr - the tick runs on the calling thread only
+    void SetThreadPool(util::ThreadPool * pool) noexcept {
+        pool_ = pool;
+    }
+
 private:
 
     [[nodiscard]] size_t ItemsCount() const override {
         return lootInstances_.size();
     }
     [[nodiscard]] cd::Item GetItem(size_t idx) const override;
+    // Note: only the dogs that moved this tick are gatherers, idle dogs can't collect anything
     [[nodiscard]] size_t GatherersCount() const override {
-        return dogs_.size();
+        return dog_moves_.size();
     }
     [[nodiscard]] cd::Gatherer GetGatherer(size_t idx) const override;
 
+    // Moves up to maxPlayers active dogs, true when all of them have moved
+    bool MoveDogs(int64_t elapsedMs, size_t maxPlayers);
+
+    void SpawnLoots(int64_t elapsedMs);
+
     void TryCollectLoots();
 
     void TryStoreLootsAtOffices();
 
+    void RefillSpawnPool();
+
+    // Empty when the tick is too small to be worth spreading over the pool
+    [[nodiscard]] cd::ParallelFor GetParallelFor() const;
+
     double GetDogRetirementTime() const noexcept {
         return dogRetirementTime_;
     }
 
 private:
 
+    static constexpr size_t MAX_FREE_DOGS = 64;
+    static constexpr size_t MOVE_CHUNK = 256;
+    static constexpr size_t PARALLEL_MIN_MOVES = 1024;
+    // Note: a few ticks of a dog's path, so a path touches a handful of cells
+    static constexpr double GATHER_GRID_CELL = 8.0;
+
+    enum class ThinkPhase
+    {
+        Move,
+        Loot,
+        Collect,
+        Store,
+        Retire,
+        Done
+    };
+    static constexpr size_t SPAWN_POOL_SIZE = 256;
+
     Id id_;
+    // Note: dense, swap-and-pop on removal; removed objects are kept in a small free list for reuse
     Dogs dogs_;
+    Dogs free_dogs_;
     Map & map_;
     double dogRetirementTime_ = 60;
 
     LootInstances lootInstances_;
     LootGeneratorPtr pLootGenerator_;
+    util::Xoshiro256 random_;
+
+    // Note: loot generator is woken up only when a spawn is due
+    int64_t loot_pending_ms_ = 0;
+    std::optional<loot_gen::LootGenerator::TimeInterval> loot_wait_;
+    std::pair<unsigned, unsigned> loot_wait_key_;
+    bool loot_wait_valid_ = false;
+
+    // Note: filled on the first random spawn and topped up by ticks, joins only pop from it
+    std::vector<glm::dvec2> spawn_pool_;
+    bool spawn_pool_used_ = false;
+
+    std::vector<Player *> active_players_;
+    DogMoves dog_moves_;
+    std::vector<Player *> players_;
+    util::ThreadPool * pool_ = nullptr;
+
+    // Note: maintained by Game - place in the list of ticked sessions and the reclamation timer
+    friend class Game;
+    static constexpr size_t NOT_AWAKE = static_cast<size_t>(-1);
+    size_t awake_index_ = NOT_AWAKE;
+    std::optional<util::TimingWheel<Id>::Handle> reclaim_;
+
+    int64_t game_time_ms_ = 0;
+    ThinkPhase think_phase_ = ThinkPhase::Done;
+    size_t think_cursor_ = 0;
+    int64_t think_elapsed_ms_ = 0;
+    // Note: only stopped dogs are here, a tick touches just the expired slots
+    RetirementWheel retirement_wheel_;
+    RetiredPlayers retired_players_;
 };
 
 
@@ -376,6 +536,10 @@ public:
     using Id = uint64_t;
 
     Player(std::string_view user_name, Token token, GameSession & session, Dog & dog);
+    ~Player();
+
+    Player(const Player &) = delete;
+    Player & operator=(const Player &) = delete;
 
     [[nodiscard]] Id GetId() const noexcept {
         return id_;
@@ -408,35 +572,89 @@ public:
     [[nodiscard]] glm::dvec2 GetPosition() const noexcept;
     [[nodiscard]] glm::dvec2 EstimateNewPosition(int64_t elapsedMs) const;
 
+    // Moves the dog, called by the session for active players only
     void Think(int64_t elapsedMs);
 
+    // Empty direction stops the dog
+    void SetDirection(std::string_view d, float speed);
+
+    // Puts the player into or out of the active set and the retirement wheel
+    void UpdateMotion();
+
     [[nodiscard]] bool IsStopped() const noexcept {
         return dog_.IsStopped();
     }
 
     [[nodiscard]] int64_t GetPlayingTimeMs() const noexcept {
-        return playing_time_ms_;
+        return (retired_ ? retired_time_ms_ : session_.GetGameTimeMs()) - join_time_ms_;
+    }
+
+    [[nodiscard]] bool IsRetired() const noexcept {
+        return retired_;
     }
 
-    bool IsRetired() const;
+    // Called by the session when the retirement time is out
+    void OnRetired() noexcept {
+        retirement_.reset();
+        retired_ = true;
+        retired_time_ms_ = session_.GetGameTimeMs();
+    }
 
 private:
 
+    friend class GameSession;
+
+    static constexpr size_t NOT_ACTIVE = static_cast<size_t>(-1);
+
     std::string user_name_;
     Token token_;
     Id id_;
     GameSession & session_;
     Dog & dog_;
-    int64_t playing_time_ms_ = 0;
-    int64_t stopped_time_ms_ = 0;
+    // Note: playing time is derived from the session clock, idle players are not touched per tick
+    int64_t join_time_ms_ = 0;
+    int64_t retired_time_ms_ = 0;
+    size_t active_index_ = NOT_ACTIVE;
+    size_t session_index_ = 0;
+    std::optional<GameSession::RetirementWheel::Handle> retirement_;
+    bool retired_ = false;
 };
 
 using PlayerVisitor = std::function<void(Player & )>;
 
+// Where a player is, without touching the player itself
+struct PlayerRoute
+{
+    GameSession::Id session;
+    Player::Id player;
+};
 
+
+/*
+ *  Каталог токенов разбит на сегменты со своими блокировками.
+ *  Вставка и удаление выполняются только в strand игры и блокируют один сегмент,
+ *  поиск маршрута из потоков ввода-вывода берёт разделяемую блокировку этого сегмента
+ *  и копирует маршрут, не обращаясь к самому игроку.
+ */
 class PlayerTokens
 {
-    using Token2Player  = std::unordered_map<Token, std::unique_ptr<Player> >;
+    // Note: the route is copied into the entry, so readers off the strand never touch the player
+    struct Entry
+    {
+        std::unique_ptr<Player> player;
+        PlayerRoute route;
+    };
+    using Token2Player = std::unordered_map<Token, Entry>;
+
+    // Note: a shard per cache line, readers of different shards don't share the lock word
+    struct alignas(64) Shard
+    {
+        Token2Player token_to_player;
+        // Note: taken exclusively by the strand only for insert/erase, strand reads go without it
+        mutable std::shared_mutex mutex;
+    };
+
+    static constexpr size_t SHARDS_COUNT = 16;
 
 public:
 
@@ -444,6 +662,12 @@ public:
     Player * Find(const Token & t) const;
     bool Remove(const Token & t);
 
+    // Thread safe, unlike the rest of the methods which run on the game strand
+    std::optional<PlayerRoute> FindRoute(const Token & t) const;
+
+    // Note: a batch join reserves the tables once instead of rehashing on the way
+    void Reserve(size_t extra);
+
     void ForEachPlayerOnMap(const Map::Id & mapId, const PlayerVisitor& pv) const;
     void ForEachPlayer(const PlayerVisitor& pv) const;
 
@@ -451,8 +675,11 @@ private:
 
     Token generate();
 
+    [[nodiscard]] Shard & GetShard(const Token & t) noexcept;
+    [[nodiscard]] const Shard & GetShard(const Token & t) const noexcept;
 
-    Token2Player token_to_player_;
+
+    std::array<Shard, SHARDS_COUNT> shards_;
     std::random_device random_device_;
 
     std::mt19937_64 generator1_{[this] {
@@ -475,6 +702,14 @@ public:
     Player * FindByToken(const Token & t) const;
     bool RemoveByToken(const Token & t);
 
+    void Reserve(size_t extra) {
+        player_tokens_.Reserve(extra);
+    }
+
+    std::optional<PlayerRoute> FindRoute(const Token & t) const {
+        return player_tokens_.FindRoute(t);
+    }
+
     void ForEachPlayerOnMap(const Map::Id & mapId, const PlayerVisitor& pv) const {
         player_tokens_.ForEachPlayerOnMap(mapId, pv);
     }
@@ -495,6 +730,7 @@ class Game
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
     using Maps         = std::vector<Map>;
     using GameSessions = std::unordered_map<GameSession::Id, std::unique_ptr<GameSession> >;
+    using MapSessions  = std::unordered_map<Map::Id, std::vector<GameSession *>, MapIdHasher>;
 
 public:
 
@@ -510,8 +746,16 @@ public:
     [[maybe_unused]] Player * Join(std::string_view userName, const Map::Id & mapId);
     Player * Join(std::string_view userName, Map & map);
 
+    // Joins all users to the map at once, players are returned in the order of names
+    std::vector<Player *> JoinMany(const std::vector<std::string> & userNames, Map & map);
+
     Player * FindPlayerByToken(const Token & t) const;
 
+    // Thread safe, the player itself may be used only on the game strand
+    std::optional<PlayerRoute> FindPlayerRoute(const Token & t) const {
+        return players_.FindRoute(t);
+    }
+
     bool RemovePlayerByToken(const Token & t);
 
     void ForEachPlayerOnMap(const Map::Id & mapId, const PlayerVisitor& pv) const {
@@ -538,6 +782,15 @@ public:
         randomize_spawn_points_ = b;
     }
 
+    // Seed of the per-session generators: spawn points, loot types and positions
+    void SetRandomSeed(uint64_t seed) noexcept {
+        random_seed_ = seed;
+    }
+
+    uint64_t GetRandomSeed() const noexcept {
+        return random_seed_;
+    }
+
     void SetLootGeneratorConfig(const loot_gen::LootGeneratorConfig & cfg) {
         lootGeneratorCfg_ = cfg;
     }
@@ -564,15 +817,83 @@ public:
 
     RetiredPlayers Think(int64_t elapsedMs);
 
+    // Resumable tick: BeginTick, then StepTick until it returns true.
+    // Players may join between the steps, nothing else may touch the game until the tick is complete
+    void BeginTick(int64_t elapsedMs);
+    bool StepTick(TimePoint deadline);
+
+    [[nodiscard]] bool IsTickRunning() const noexcept {
+        return tick_running_;
+    }
+
+    // Players retired by the ticks completed since the previous call
+    [[nodiscard]] RetiredPlayers TakeRetiredPlayers() {
+        return std::exchange(tick_retired_, {});
+    }
+
+    // Session without players is freed after this time, unless somebody joins
+    void SetSessionGracePeriod(int64_t ms) noexcept {
+        session_grace_period_ms_ = ms;
+    }
+
+    // 0 - unlimited, one session per map
+    void SetMaxPlayersPerSession(size_t n) noexcept {
+        max_players_per_session_ = n;
+    }
+
+    size_t GetMaxPlayersPerSession() const noexcept {
+        return max_players_per_session_;
+    }
+
+    [[nodiscard]] size_t GetSessionsCount() const noexcept {
+        return sessions_.size();
+    }
+
+    [[nodiscard]] size_t GetAwakeSessionsCount() const noexcept {
+        return awake_sessions_.size();
+    }
+
+    // Sessions ticked by Think
+    [[nodiscard]] const std::vector<GameSession *> & GetAwakeSessions() const noexcept {
+        return awake_sessions_;
+    }
+
+    // Big sessions move dogs and look for collisions on this many threads, the ticking one included.
+    // Must not be called while a tick is running
+    void SetSimulationThreads(size_t threads);
+
 private:
 
     GameSession & GetOrCreateSession(Map & map);
 
+    void PlaceNewDog(GameSession & session, Dog & dog) const;
+
+    void WakeSession(GameSession & session);
+    void HibernateSession(GameSession & session);
+
 
     Maps maps_;
     MapIdToIndex map_id_to_index_;
 
+    // Note: declared before the sessions, they keep a pointer to it
+    std::unique_ptr<util::ThreadPool> sim_pool_;
     GameSessions sessions_;
+    // Note: shards of every map, a join looks only at the sessions of its map
+    MapSessions map_sessions_;
+    size_t max_players_per_session_ = 0;
+    uint64_t sessions_created_ = 0;
+    std::vector<GameSession *> awake_sessions_;
+    util::TimingWheel<GameSession::Id> reclaim_wheel_;
+    int64_t game_time_ms_ = 0;
+    int64_t session_grace_period_ms_ = 60000;
+
+    // Note: state of a tick split into steps
+    std::vector<GameSession *> tick_sessions_;
+    size_t tick_index_ = 0;
+    int64_t tick_elapsed_ms_ = 0;
+    bool tick_running_ = false;
+    RetiredPlayers tick_retired_;
+
     Players players_;
 
     float defaultDogSpeed_ = 1;
@@ -581,6 +902,7 @@ private:
     size_t defaultBagCapacity_ = 3;
     double dogRetirementTime_ = 60;
     loot_gen::LootGeneratorConfig lootGeneratorCfg_;
+    uint64_t random_seed_ = std::random_device{}();
 };
 
 }  // namespace model
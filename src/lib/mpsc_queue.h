@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace util
+{
+
+/*
+ *  Очередь "много писателей - один читатель" без блокировок.
+ *  Писатели добавляют элементы из любых потоков, читатель забирает всё накопленное за раз
+ *  и обрабатывает в порядке добавления.
+ */
+template <typename Value>
+class MpscQueue
+{
+    struct Node
+    {
+        Value value;
+        Node * next = nullptr;
+    };
+
+public:
+
+    MpscQueue() = default;
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue & operator=(const MpscQueue &) = delete;
+
+    ~MpscQueue() {
+        Free(head_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Thread safe
+    void Push(Value value) {
+        auto * node = new Node{std::move(value)};
+
+        // Note: Treiber stack push, the consumer restores FIFO order when it takes the batch
+        node->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(node->next, node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // Single consumer only. Calls fn for every element pushed so far, oldest first
+    template <typename Fn>
+    size_t Drain(Fn && fn) {
+        Node * node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (!node)
+            return 0;
+
+        Node * reversed = nullptr;
+        while (node) {
+            Node * next = std::exchange(node->next, reversed);
+            reversed = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        while (reversed) {
+            Node * next = reversed->next;
+            try {
+                fn(std::move(reversed->value));
+            }
+            catch (...) {
+                delete reversed;
+                Free(next);
+                throw;
+            }
+            delete reversed;
+            reversed = next;
+            ++count;
+        }
+
+        return count;
+    }
+
+    // Hint only, the queue may change right after the call
+    [[nodiscard]] bool Empty() const noexcept {
+        return head_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+
+    static void Free(Node * node) noexcept {
+        while (node)
+            delete std::exchange(node, node->next);
+    }
+
+    std::atomic<Node *> head_ = nullptr;
+};
+
+}  // namespace util
@@ -0,0 +1,57 @@
+#include "random.h"
+
+#include <numeric>
+#include <stdexcept>
+
+
+namespace util
+{
+
+AliasTable::AliasTable(const std::vector<double> & weights)
+{
+    const size_t n = weights.size();
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    if (n == 0 || !(total > 0.0))
+        throw std::invalid_argument("Alias table needs a positive total weight");
+
+    prob_.resize(n);
+    alias_.resize(n);
+
+    // Note: weights are scaled so that the average column is exactly 1
+    std::vector<double> scaled(n);
+    std::vector<size_t> small;
+    std::vector<size_t> large;
+
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * static_cast<double>(n) / total;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+        const size_t s = small.back();
+        small.pop_back();
+        const size_t l = large.back();
+
+        prob_[s]  = scaled[s];
+        alias_[s] = l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Note: leftovers differ from 1 only by rounding error
+    for (size_t i : large) {
+        prob_[i]  = 1.0;
+        alias_[i] = i;
+    }
+    for (size_t i : small) {
+        prob_[i]  = 1.0;
+        alias_[i] = i;
+    }
+}
+
+}  // namespace util
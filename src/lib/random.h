@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace util
+{
+
+/*
+ *  Генератор псевдослучайных чисел xoshiro256++ (https://prng.di.unimi.it/).
+ *  Удовлетворяет требованиям UniformRandomBitGenerator, поэтому подходит для
+ *  распределений std::*_distribution. Состояние - 32 байта, без системных вызовов.
+ */
+class Xoshiro256
+{
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 0) noexcept {
+        Seed(seed);
+    }
+
+    // Note: state is expanded by splitmix64, any seed (even 0) gives a good state
+    void Seed(uint64_t seed) noexcept {
+        for (auto & s : s_)
+            s = SplitMix64(seed);
+    }
+
+    static constexpr result_type min() noexcept {
+        return 0;
+    }
+
+    static constexpr result_type max() noexcept {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() noexcept {
+        const uint64_t result = Rotl(s_[0] + s_[3], 23) + s_[0];
+        const uint64_t t = s_[1] << 17;
+
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+
+        s_[2] ^= t;
+        s_[3] = Rotl(s_[3], 45);
+
+        return result;
+    }
+
+    // Uniform double in [0, 1)
+    double NextDouble() noexcept {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Uniform integer in [0, n), n > 0
+    uint64_t NextIndex(uint64_t n) noexcept {
+        // Note: multiply-shift (Lemire), the bias is negligible for small n
+        return static_cast<uint64_t>((static_cast<unsigned __int128>((*this)()) * n) >> 64);
+    }
+
+    static uint64_t SplitMix64(uint64_t & x) noexcept {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+private:
+
+    static constexpr uint64_t Rotl(uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t s_[4] = {};
+};
+
+
+/*
+ *  Таблица псевдонимов (метод Воуза) для выбора индекса с заданными весами за O(1).
+ *  Строится один раз за O(n).
+ */
+class AliasTable
+{
+public:
+
+    AliasTable() = default;
+
+    // weights - non-negative, at least one of them positive
+    explicit AliasTable(const std::vector<double> & weights);
+
+    [[nodiscard]] bool Empty() const noexcept {
+        return prob_.empty();
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return prob_.size();
+    }
+
+    template <typename Rng>
+    size_t Sample(Rng & rng) const {
+        const size_t column = static_cast<size_t>(rng.NextIndex(prob_.size()));
+        return rng.NextDouble() < prob_[column] ? column : alias_[column];
+    }
+
+private:
+
+    std::vector<double> prob_;
+    std::vector<size_t> alias_;
+};
+
+}  // namespace util
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace util
+{
+
+/*
+ *  Маршрутизатор путей на префиксном дереве сегментов, строится на этапе компиляции.
+ *  Шаблон маршрута - сегменты через '/':
+ *    "{name}"  - параметр, совпадает с любым одним сегментом;
+ *    "*"       - только последним, совпадает с остатком пути из одного и более сегментов.
+ *  В каждом узле сначала ищется точное совпадение сегмента, затем параметр:
+ *  если ветка точного сегмента зашла в тупик, поиск возвращается к параметру.
+ *  Если путь не нашёлся, выбирается самый глубокий пройденный "*".
+ *  Время поиска зависит от числа сегментов пути и ветвлений на параметрах, а не от числа маршрутов.
+ */
+template <size_t MaxNodes, size_t MaxParams = 2>
+class RouteTrie
+{
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    static_assert(MaxNodes > 0 && MaxNodes < NONE);
+
+    struct Node
+    {
+        std::string_view segment;
+        uint16_t first_child  = NONE;   // children matched exactly
+        uint16_t next_sibling = NONE;
+        uint16_t param_child  = NONE;
+        uint16_t route        = NONE;   // route which ends here
+        uint16_t rest_route   = NONE;   // route "<this node>/*"
+    };
+
+public:
+
+    struct Match
+    {
+        size_t route = 0;
+        // Note: values of the {name} segments in the order of the pattern
+        std::array<std::string_view, MaxParams> params{};
+        size_t param_count = 0;
+        // Note: for a "*" route, the part of the path it covered
+        std::string_view rest;
+    };
+
+    // Route i is patterns[i]. A bad or conflicting pattern throws, inside a constant expression it is a compile error
+    template <size_t Routes>
+    constexpr explicit RouteTrie(const std::array<std::string_view, Routes> & patterns) {
+        static_assert(Routes < NONE);
+
+        for (size_t i = 0; i < Routes; ++i)
+            Insert(patterns[i], static_cast<uint16_t>(i));
+    }
+
+    [[nodiscard]] constexpr std::optional<Match> Find(std::string_view path) const noexcept {
+        Match match;
+        RestMatch rest;
+
+        if (Descend(0, path, 0, match, rest))
+            return match;
+
+        if (rest.route == NONE)
+            return std::nullopt;
+
+        rest.match.route = rest.route;
+        return rest.match;
+    }
+
+    [[nodiscard]] constexpr size_t GetNodeCount() const noexcept {
+        return size_;
+    }
+
+private:
+
+    // Note: the "*" route to fall back to, found on the way down
+    struct RestMatch
+    {
+        Match match;
+        uint16_t route = NONE;
+        size_t pos = 0;
+    };
+
+    static constexpr bool IsParam(std::string_view segment) noexcept {
+        return segment.size() >= 2 && segment.front() == '{' && segment.back() == '}';
+    }
+
+    // Note: recursion depth is bounded by the depth of the trie, not by the length of the path
+    constexpr bool Descend(uint16_t node, std::string_view path, size_t pos,
+                           Match & match, RestMatch & rest) const noexcept {
+        // Note: the deepest "*" wins, at equal depth the one reached first, i.e. by exact segments
+        if (nodes_[node].rest_route != NONE && (rest.route == NONE || pos > rest.pos)) {
+            rest.route      = nodes_[node].rest_route;
+            rest.pos        = pos;
+            rest.match      = match;
+            rest.match.rest = path.substr(pos);
+        }
+
+        const size_t end = std::min(path.find('/', pos), path.size());
+        const auto segment = path.substr(pos, end - pos);
+
+        auto enter = [&](uint16_t next) {
+            if (end != path.size())
+                return Descend(next, path, end + 1, match, rest);
+            if (nodes_[next].route == NONE)
+                return false;
+
+            match.route = nodes_[next].route;
+            match.rest  = {};
+            return true;
+        };
+
+        if (auto next = FindChild(node, segment); next != NONE && enter(next))
+            return true;
+
+        // Note: a dead end after an exact segment falls back to the parameter sibling
+        if (auto next = nodes_[node].param_child; next != NONE) {
+            match.params[match.param_count++] = segment;
+            if (enter(next))
+                return true;
+
+            match.params[--match.param_count] = {};
+        }
+
+        return false;
+    }
+
+    constexpr uint16_t FindChild(uint16_t node, std::string_view segment) const noexcept {
+        // Note: siblings are few, a linear pass over them is cheaper than anything else
+        for (auto child = nodes_[node].first_child; child != NONE; child = nodes_[child].next_sibling)
+            if (nodes_[child].segment == segment)
+                return child;
+
+        return NONE;
+    }
+
+    constexpr uint16_t AddNode(std::string_view segment) {
+        if (size_ == MaxNodes)
+            throw std::length_error("Route trie is full");
+
+        nodes_[size_].segment = segment;
+        return static_cast<uint16_t>(size_++);
+    }
+
+    constexpr void Insert(std::string_view pattern, uint16_t route) {
+        if (pattern.empty())
+            throw std::invalid_argument("Empty route pattern");
+
+        uint16_t node = 0;
+        size_t params = 0;
+        size_t pos = 0;
+        for (;;) {
+            const size_t end = std::min(pattern.find('/', pos), pattern.size());
+            const auto segment = pattern.substr(pos, end - pos);
+            const bool last = end == pattern.size();
+
+            if (segment == "*") {
+                if (!last)
+                    throw std::invalid_argument("'*' must be the last segment of a route");
+                if (nodes_[node].rest_route != NONE)
+                    throw std::invalid_argument("Duplicate route");
+
+                nodes_[node].rest_route = route;
+                return;
+            }
+
+            if (IsParam(segment)) {
+                if (++params > MaxParams)
+                    throw std::invalid_argument("Too many route parameters");
+                if (nodes_[node].param_child == NONE)
+                    nodes_[node].param_child = AddNode(segment);
+
+                node = nodes_[node].param_child;
+            }
+            else if (auto child = FindChild(node, segment); child != NONE)
+                node = child;
+            else {
+                child = AddNode(segment);
+                nodes_[child].next_sibling = nodes_[node].first_child;
+                nodes_[node].first_child = child;
+                node = child;
+            }
+
+            if (last) {
+                if (nodes_[node].route != NONE)
+                    throw std::invalid_argument("Duplicate route");
+
+                nodes_[node].route = route;
+                return;
+            }
+
+            pos = end + 1;
+        }
+    }
+
+    std::array<Node, MaxNodes> nodes_{};
+    size_t size_ = 1;   // node 0 is the root
+};
+
+}   // namespace util
@@ -0,0 +1,103 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace util
+{
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers_.emplace_back([this](std::stop_token stop) {
+            WorkerLoop(stop);
+        });
+}
+
+ThreadPool::~ThreadPool()
+{
+    for (auto & w : workers_)
+        w.request_stop();
+
+    // Note: jthread joins on destruction, workers leave the wait on the stop request
+    workers_.clear();
+}
+
+void ThreadPool::ParallelFor(size_t count, const RangeFn & fn)
+{
+    if (count == 0)
+        return;
+
+    if (workers_.empty() || count == 1) {
+        fn(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        fn_    = &fn;
+        count_ = count;
+        // Note: a few ranges per thread, so a slow range does not hold everybody
+        grain_ = std::max<size_t>(1, count / (GetConcurrency() * 4));
+        next_.store(0, std::memory_order_relaxed);
+        busy_  = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    RunRanges();
+
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] {
+        return busy_ == 0;
+    });
+    fn_ = nullptr;
+
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void ThreadPool::WorkerLoop(std::stop_token stop)
+{
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock lock(mutex_);
+            if (!wake_.wait(lock, stop, [this, seen] { return generation_ != seen; }))
+                return;
+            seen = generation_;
+        }
+
+        RunRanges();
+
+        {
+            std::lock_guard lock(mutex_);
+            --busy_;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::RunRanges()
+{
+    for (;;) {
+        const size_t begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+        if (begin >= count_)
+            return;
+
+        try {
+            (*fn_)(begin, std::min(count_, begin + grain_));
+        }
+        catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+    }
+}
+
+}  // namespace util
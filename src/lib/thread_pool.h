@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+
+/*
+ *  Пул потоков для параллельных циклов внутри такта.
+ *  Вызывающий поток тоже выполняет часть работы, поэтому ParallelFor на пуле из n потоков
+ *  использует n + 1 ядро. Вызовы ParallelFor не должны пересекаться (работает один поток симуляции).
+ */
+class ThreadPool
+{
+public:
+    using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+    // threads - number of extra worker threads
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] size_t GetConcurrency() const noexcept {
+        return workers_.size() + 1;
+    }
+
+    // Calls fn for disjoint ranges covering [0, count) and returns when all of them are done.
+    // The first exception thrown by fn is rethrown here
+    void ParallelFor(size_t count, const RangeFn & fn);
+
+private:
+
+    void WorkerLoop(std::stop_token stop);
+    void RunRanges();
+
+    std::vector<std::jthread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::condition_variable done_;
+
+    // Note: the current job, workers pick up ranges of grain_ items by next_
+    const RangeFn * fn_ = nullptr;
+    size_t count_ = 0;
+    size_t grain_ = 1;
+    std::atomic<size_t> next_ = 0;
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    std::exception_ptr error_;
+};
+
+}  // namespace util
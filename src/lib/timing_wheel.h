@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <utility>
+
+namespace util
+{
+
+/*
+ *  Иерархическое колесо таймеров.
+ *  Время задаётся в тактах колеса (resolution единиц времени на такт).
+ *  Уровень L состоит из NUM_SLOTS ячеек по NUM_SLOTS^L тактов каждая. Когда младший
+ *  уровень проходит полный круг, очередная ячейка старшего уровня раскладывается
+ *  по младшим уровням.
+ *  Вставка и удаление - O(1), Advance обходит только наступившие ячейки.
+ */
+template <typename Value>
+class TimingWheel
+{
+    struct Entry
+    {
+        Value value;
+        uint64_t deadline;      // такт срабатывания
+        unsigned level;
+        unsigned slot;
+    };
+
+    using Slot = std::list<Entry>;
+
+public:
+
+    static constexpr unsigned SLOT_BITS  = 6;
+    static constexpr unsigned NUM_SLOTS  = 1u << SLOT_BITS;
+    static constexpr unsigned NUM_LEVELS = 4;
+    static constexpr uint64_t MAX_DELTA  = (uint64_t{1} << (SLOT_BITS * NUM_LEVELS)) - 1;
+
+    // Note: stays valid until the entry is removed or expired, cascading does not move list nodes
+    using Handle = typename Slot::iterator;
+
+    explicit TimingWheel(uint64_t resolution = 1) : resolution_(resolution ? resolution : 1) {
+    }
+
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel & operator=(const TimingWheel &) = delete;
+
+    [[nodiscard]] uint64_t GetTime() const noexcept {
+        return current_ * resolution_;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    // time - absolute time of expiration, a time in the past expires on the next Advance
+    Handle Insert(Value value, uint64_t time) {
+        uint64_t deadline = (time + resolution_ - 1) / resolution_;
+        if (deadline <= current_)
+            deadline = current_ + 1;
+
+        auto [level, slot] = Locate(deadline);
+        auto & list = slots_[level][slot];
+        list.push_back(Entry{std::move(value), deadline, level, slot});
+        ++size_;
+
+        return std::prev(list.end());
+    }
+
+    void Remove(Handle h) {
+        slots_[h->level][h->slot].erase(h);
+        --size_;
+    }
+
+    // Moves the wheel to time and calls fn(Value&&) for every expired entry in order of expiration
+    template <typename Fn>
+    void Advance(uint64_t time, Fn && fn) {
+        const uint64_t target = time / resolution_;
+
+        while (current_ < target) {
+            // Note: nothing to expire, skip the empty turns at once
+            if (size_ == 0) {
+                current_ = target;
+                break;
+            }
+
+            ++current_;
+            Cascade();
+
+            auto & list = slots_[0][current_ & MASK];
+            while (!list.empty()) {
+                Value value = std::move(list.front().value);
+                list.pop_front();
+                --size_;
+
+                fn(std::move(value));
+            }
+        }
+    }
+
+private:
+
+    static constexpr uint64_t MASK = NUM_SLOTS - 1;
+
+    [[nodiscard]] std::pair<unsigned, unsigned> Locate(uint64_t deadline) const noexcept {
+        uint64_t delta = deadline - current_;
+        // Note: too far - park in the top level, the entry is placed again when it cascades
+        if (delta > MAX_DELTA) {
+            delta = MAX_DELTA;
+            deadline = current_ + MAX_DELTA;
+        }
+
+        unsigned level = 0;
+        while (level + 1 < NUM_LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1))))
+            ++level;
+
+        return { level, static_cast<unsigned>((deadline >> (SLOT_BITS * level)) & MASK) };
+    }
+
+    void Cascade() {
+        for (unsigned level = 1; level < NUM_LEVELS; ++level) {
+            // Note: a level moves only when all lower levels complete the turn
+            if ((current_ & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0)
+                break;
+
+            auto & list = slots_[level][(current_ >> (SLOT_BITS * level)) & MASK];
+            while (!list.empty()) {
+                auto it = list.begin();
+                auto [lower, slot] = Locate(it->deadline);
+                it->level = lower;
+                it->slot  = slot;
+
+                auto & dst = slots_[lower][slot];
+                dst.splice(dst.end(), list, it);
+            }
+        }
+    }
+
+    uint64_t resolution_;
+    uint64_t current_ = 0;
+    size_t size_ = 0;
+    std::array<std::array<Slot, NUM_SLOTS>, NUM_LEVELS> slots_;
+};
+
+}  // namespace util
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+
+namespace util
+{
+
+/*
+ *  Очередь со взвешенным справедливым обслуживанием (WFQ) для Classes классов.
+ *  Каждому элементу при добавлении назначается виртуальное время окончания:
+ *  max(текущее виртуальное время, окончание предыдущего элемента класса) + 1 / вес класса.
+ *  Pop отдаёт элемент с наименьшим временем, поэтому при полной загрузке классы получают
+ *  доли в пропорции весов, а класс с пустой очередью не копит "кредит" на будущее.
+ *  Не потокобезопасна.
+ */
+template <typename Value, size_t Classes>
+class WeightedFairQueue
+{
+    // Note: integer virtual time, a weight is at most STEP
+    static constexpr uint64_t STEP = 1 << 20;
+
+    struct Entry
+    {
+        uint64_t finish;
+        Value value;
+    };
+
+public:
+
+    using Weights = std::array<unsigned, Classes>;
+
+    explicit WeightedFairQueue(const Weights & weights) {
+        for (size_t c = 0; c < Classes; ++c) {
+            assert(weights[c] > 0 && weights[c] <= STEP);
+            cost_[c] = STEP / std::max(1u, weights[c]);
+        }
+    }
+
+    void Push(size_t cls, Value value) {
+        assert(cls < Classes);
+
+        const uint64_t finish = std::max(virtual_time_, last_finish_[cls]) + cost_[cls];
+        last_finish_[cls] = finish;
+        queues_[cls].push_back(Entry{finish, std::move(value)});
+        ++size_;
+    }
+
+    // The element with the earliest finish time, ties go to the lower class
+    std::optional<std::pair<size_t, Value>> Pop() {
+        size_t best = Classes;
+        for (size_t c = 0; c < Classes; ++c) {
+            if (!queues_[c].empty() && (best == Classes || queues_[c].front().finish < queues_[best].front().finish))
+                best = c;
+        }
+
+        if (best == Classes)
+            return std::nullopt;
+
+        auto & entry = queues_[best].front();
+        virtual_time_ = entry.finish;
+        std::pair<size_t, Value> ret{best, std::move(entry.value)};
+        queues_[best].pop_front();
+        --size_;
+
+        return ret;
+    }
+
+    [[nodiscard]] bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] size_t Size(size_t cls) const noexcept {
+        return queues_[cls].size();
+    }
+
+private:
+
+    std::array<std::deque<Entry>, Classes> queues_;
+    std::array<uint64_t, Classes> cost_{};
+    std::array<uint64_t, Classes> last_finish_{};
+    uint64_t virtual_time_ = 0;
+    size_t size_ = 0;
+};
+
+}  // namespace util
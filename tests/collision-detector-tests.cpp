@@ -65,3 +65,55 @@ TEST_CASE("FindGatherEvents test")
     res = FindGatherEvents(itemGathererProvider);
     REQUIRE(res.size() == 1);
 }
+
+TEST_CASE("FindGatherEventsInGrid matches FindGatherEvents")
+{
+    CItemGathererProviderMock itemGathererProvider;
+
+    // Note: fixed LCG, so a failure is reproducible
+    uint64_t state = 42;
+    auto next = [&state](double lo, double hi) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return lo + (hi - lo) * static_cast<double>(state >> 11) / static_cast<double>(1ULL << 53);
+    };
+
+    for (int i = 0; i < 2000; ++i)
+        itemGathererProvider.AddItem({.position = { next(0, 100), next(0, 100) }, .width = next(0, 0.5) });
+    // Note: items on the same spot give events with equal time
+    itemGathererProvider.AddItem({.position = { 50, 50 }, .width = 0 });
+    itemGathererProvider.AddItem({.position = { 50, 50 }, .width = 0 });
+
+    for (int g = 0; g < 500; ++g) {
+        glm::dvec2 start = { next(-5, 105), next(-5, 105) };
+        glm::dvec2 end   = start + glm::dvec2{ next(-10, 10), next(-10, 10) };
+        itemGathererProvider.AddGatherer({.start_pos = start, .end_pos = end, .width = 0.6 });
+    }
+    itemGathererProvider.AddGatherer({.start_pos = { 40, 50 }, .end_pos = { 60, 50 }, .width = 0.6 });
+    itemGathererProvider.AddGatherer({.start_pos = { 50, 40 }, .end_pos = { 50, 60 }, .width = 0.6 });
+    itemGathererProvider.AddGatherer({.start_pos = { 3, 3 }, .end_pos = { 3, 3 }, .width = 0.6 });
+
+    const auto expected = FindGatherEvents(itemGathererProvider);
+    REQUIRE(!expected.empty());
+
+    auto same = [&expected](const std::vector<GatheringEvent> & res) {
+        REQUIRE(res.size() == expected.size());
+        for (size_t n = 0; n < res.size(); ++n) {
+            CHECK(res[n].item_id     == expected[n].item_id);
+            CHECK(res[n].gatherer_id == expected[n].gatherer_id);
+            CHECK(res[n].time        == expected[n].time);
+        }
+    };
+
+    SECTION("serial") {
+        for (double cell : { 0.25, 1.0, 8.0, 1000.0 })
+            same(FindGatherEventsInGrid(itemGathererProvider, cell));
+    }
+
+    SECTION("tasks in reverse order") {
+        ParallelFor reversed = [](size_t count, const std::function<void(size_t, size_t)> & fn) {
+            for (size_t n = count; n > 0; --n)
+                fn(n - 1, n);
+        };
+        same(FindGatherEventsInGrid(itemGathererProvider, 4.0, reversed));
+    }
+}
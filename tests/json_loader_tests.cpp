@@ -0,0 +1,35 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/json_loader.h"
+
+using namespace std::string_view_literals;
+namespace json = boost::json;
+
+SCENARIO("Unsigned integers from JSON")
+{
+    GIVEN("a records request body") {
+        const auto body = json::parse(R"({"start":0,"maxItems":10})"sv);
+        const auto & params = body.as_object();
+
+        THEN("small numbers stored as int64 are read") {
+            REQUIRE(params.at("start"sv).is_int64());
+            REQUIRE(json_loader::GetUint64(params.at("start"sv)) == 0u);
+            REQUIRE(json_loader::GetUint64(params.at("maxItems"sv)) == 10u);
+        }
+    }
+
+    GIVEN("values which are not unsigned integers") {
+        THEN("they are rejected without throwing") {
+            REQUIRE(!json_loader::GetUint64(json::parse("-1"sv)));
+            REQUIRE(!json_loader::GetUint64(json::parse("2.5"sv)));
+            REQUIRE(!json_loader::GetUint64(json::parse(R"("10")"sv)));
+            REQUIRE(!json_loader::GetUint64(json::parse("null"sv)));
+        }
+    }
+
+    GIVEN("a number above the int64 range") {
+        THEN("it is read as uint64") {
+            REQUIRE(json_loader::GetUint64(json::parse("18446744073709551615"sv)) == UINT64_MAX);
+        }
+    }
+}
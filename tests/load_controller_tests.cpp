@@ -0,0 +1,132 @@
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/load_controller.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    void Feed(app::LoadController & controller, std::chrono::milliseconds tick, int count) {
+        for (int i = 0; i < count; ++i)
+            controller.OnTick(tick);
+    }
+}
+
+SCENARIO("Load controller")
+{
+    GIVEN("a controller for a 10ms tick") {
+        app::LoadController controller(10ms, 8);
+
+        THEN("it starts at the nominal period and is not overloaded") {
+            REQUIRE(controller.GetTickPeriod() == 10ms);
+            REQUIRE(controller.GetMaxStep() == 10ms * app::LoadController::MAX_STRETCH);
+            REQUIRE(!controller.IsOverloaded());
+        }
+
+        WHEN("a single tick takes five periods") {
+            controller.OnTick(50ms);
+
+            THEN("the moving average absorbs it and the period stays") {
+                REQUIRE(controller.GetTickPeriod() == 10ms);
+                REQUIRE(!controller.IsOverloaded());
+            }
+        }
+
+        WHEN("ticks keep taking longer than the stretched period") {
+            Feed(controller, 100ms, 50);
+
+            THEN("the period is stretched up to the cap and then requests are shed") {
+                REQUIRE(controller.GetTickPeriod() == controller.GetMaxStep());
+                REQUIRE(controller.IsOverloaded());
+                REQUIRE(controller.GetTickCount() == 50);
+            }
+
+            AND_WHEN("ticks settle between the low and the high watermark") {
+                // Note: 26ms of the 40ms period is 0.65, neither watermark is crossed once the average settles
+                Feed(controller, 26ms, 100);
+
+                THEN("the state does not flap") {
+                    REQUIRE(controller.GetTickPeriod() == controller.GetMaxStep());
+                    REQUIRE(controller.IsOverloaded());
+                }
+            }
+
+            AND_WHEN("ticks become short") {
+                controller.OnTick(0ms);
+                int ticks = 1;
+                while (controller.IsOverloaded() && ticks < 100) {
+                    controller.OnTick(0ms);
+                    ++ticks;
+                }
+
+                THEN("shedding stops as the period starts to shrink") {
+                    REQUIRE(!controller.IsOverloaded());
+                    REQUIRE(controller.GetTickPeriod() < controller.GetMaxStep());
+                    REQUIRE(controller.GetTickPeriod() > 10ms);
+                }
+
+                THEN("the period goes back to nominal step by step") {
+                    auto previous = controller.GetTickPeriod();
+                    for (int i = 0; i < 100; ++i) {
+                        controller.OnTick(0ms);
+                        REQUIRE(controller.GetTickPeriod() <= previous);
+                        previous = controller.GetTickPeriod();
+                    }
+                    REQUIRE(controller.GetTickPeriod() == 10ms);
+                }
+            }
+        }
+
+        WHEN("the request backlog reaches half of the limit") {
+            for (int i = 0; i < 4; ++i)
+                controller.OnRequestQueued();
+            controller.OnTick(0ms);
+
+            THEN("the period is stretched even though ticks are short") {
+                REQUIRE(controller.GetTickPeriod() > 10ms);
+                REQUIRE(!controller.IsOverloaded());
+            }
+
+            AND_WHEN("it reaches the limit") {
+                for (int i = 0; i < 4; ++i)
+                    controller.OnRequestQueued();
+
+                THEN("requests are shed at once, without waiting for a tick") {
+                    REQUIRE(controller.GetBacklog() == 8);
+                    REQUIRE(controller.IsOverloaded());
+
+                    controller.OnRequestStarted();
+                    REQUIRE(!controller.IsOverloaded());
+                }
+            }
+        }
+
+        THEN("Retry-After is at least a second") {
+            REQUIRE(controller.GetRetryAfter() == 1s);
+        }
+    }
+
+    GIVEN("a controller for a long tick") {
+        app::LoadController controller(600ms);
+
+        THEN("Retry-After covers the longest stretched tick") {
+            // Note: 4 * 600ms rounded up
+            REQUIRE(controller.GetRetryAfter() == 3s);
+        }
+    }
+
+    GIVEN("a controller without a ticker") {
+        app::LoadController controller(0ms, 8);
+
+        WHEN("ticks are long") {
+            Feed(controller, 1000ms, 20);
+
+            THEN("only the backlog is watched") {
+                REQUIRE(controller.GetTickPeriod() == 0ms);
+                REQUIRE(!controller.IsOverloaded());
+                REQUIRE(controller.GetTickCount() == 20);
+            }
+        }
+    }
+}
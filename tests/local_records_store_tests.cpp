@@ -0,0 +1,152 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <boost/asio/io_context.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/local_records_store.h"
+
+using namespace std::string_literals;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Records file removed at the end of the test
+    struct TempFile
+    {
+        fs::path path = fs::temp_directory_path() / ("records_"s + std::to_string(std::random_device{}()) + ".log"s);
+
+        ~TempFile() {
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+
+        void Write(const std::string & content) const {
+            std::ofstream(path, std::ios::binary) << content;
+        }
+
+        [[nodiscard]] std::string Read() const {
+            std::ifstream file(path, std::ios::binary);
+            std::stringstream ss;
+            ss << file.rdbuf();
+            return ss.str();
+        }
+    };
+
+    db::RecordItem Record(std::string id, std::string name, int score, int64_t play_time_ms) {
+        return { .id = std::move(id), .name = std::move(name), .score = score, .play_time_ms = play_time_ms };
+    }
+}
+
+SCENARIO("Local records store")
+{
+    TempFile file;
+    boost::asio::io_context writer;
+
+    GIVEN("records inserted into a new file") {
+        {
+            db::LocalRecordsStore store(file.path, writer.get_executor());
+            store.InsertRecord(Record("1", "plain", 10, 100));
+            store.InsertRecord(Record("2", "tab\there\nnew line \\ slash", 20, 200));
+
+            THEN("they are served from memory at once") {
+                REQUIRE(store.Size() == 2);
+                REQUIRE(store.LoadTop(10).front().id == "2");
+            }
+
+            // Note: the lines are written on the writer executor
+            writer.run();
+        }
+
+        THEN("each record takes one line with the name escaped") {
+            REQUIRE(file.Read() == "1\t10\t100\tplain\n"
+                                   "2\t20\t200\ttab\\there\\nnew line \\\\ slash\n");
+        }
+
+        WHEN("the file is opened again") {
+            db::LocalRecordsStore store(file.path, writer.get_executor());
+
+            THEN("the records are read back in leaderboard order") {
+                auto top = store.LoadTop(10);
+                REQUIRE(top.size() == 2);
+                REQUIRE(top[0].id == "2");
+                REQUIRE(top[0].name == "tab\there\nnew line \\ slash");
+                REQUIRE(top[0].score == 20);
+                REQUIRE(top[0].play_time_ms == 200);
+                REQUIRE(top[1].name == "plain");
+            }
+        }
+    }
+
+    GIVEN("records which are still buffered when the store is destroyed") {
+        {
+            db::LocalRecordsStore store(file.path, writer.get_executor());
+            store.InsertRecord(Record("1", "a", 1, 1));
+        }
+
+        THEN("the destructor writes them") {
+            REQUIRE(file.Read() == "1\t1\t1\ta\n");
+        }
+    }
+
+    GIVEN("a file whose last record was torn by a crash") {
+        file.Write("1\t10\t100\tbob\n"
+                   "bad line\n"
+                   "2\t30\t300\tali");
+
+        WHEN("it is opened") {
+            db::LocalRecordsStore store(file.path, writer.get_executor());
+
+            THEN("the torn and malformed records are skipped") {
+                REQUIRE(store.Size() == 1);
+                REQUIRE(store.LoadTop(10).front().id == "1");
+            }
+
+            THEN("the torn tail is cut off the file") {
+                REQUIRE(file.Read() == "1\t10\t100\tbob\nbad line\n");
+            }
+
+            AND_WHEN("a record is appended and the file is opened again") {
+                store.InsertRecord(Record("3", "carol", 20, 200));
+                writer.run();
+
+                db::LocalRecordsStore reloaded(file.path, writer.get_executor());
+
+                THEN("the new record does not complete the torn one") {
+                    auto top = reloaded.LoadTop(10);
+                    REQUIRE(top.size() == 2);
+                    REQUIRE(top[0].id == "3");
+                    REQUIRE(top[0].name == "carol");
+                    REQUIRE(top[1].id == "1");
+                }
+            }
+        }
+    }
+
+    GIVEN("a store with records of equal score") {
+        db::LocalRecordsStore store(file.path, writer.get_executor());
+        store.InsertRecord(Record("a", "x", 10, 100));
+        store.InsertRecord(Record("b", "x", 10, 100));
+        store.InsertRecord(Record("c", "y", 10, 100));
+        store.InsertRecord(Record("d", "z", 5, 100));
+
+        THEN("a cursor page continues after the tie") {
+            auto page = store.GetPage({ .after = Record("b", "x", 10, 100), .maxItems = 10 });
+            REQUIRE(page.size() == 2);
+            REQUIRE(page[0].id == "c");
+            REQUIRE(page[1].id == "d");
+        }
+
+        THEN("an offset page skips from the top") {
+            auto page = store.GetPage({ .start = 1, .maxItems = 2 });
+            REQUIRE(page.size() == 2);
+            REQUIRE(page[0].id == "b");
+            REQUIRE(page[1].id == "c");
+        }
+
+        writer.run();
+    }
+}
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <random>
 #include <catch2/catch_test_macros.hpp>
 
 #include "../src/lib/loot_generator.h"
@@ -73,3 +74,69 @@ SCENARIO("Loot generation")
         }
     }
 }
+
+SCENARIO("Loot spawn scheduling")
+{
+    using loot_gen::LootGenerator;
+    using TimeInterval = LootGenerator::TimeInterval;
+
+    GIVEN("a generator polled every tick and a generator woken up by TimeUntilLoot") {
+        LootGenerator polled{5s, 0.5};
+        LootGenerator scheduled{5s, 0.5};
+
+        std::mt19937 rng{2024};
+        std::uniform_int_distribution<int> tick_dist(1, 120);
+        std::uniform_int_distribution<unsigned> looters_dist(0, 6);
+
+        WHEN("both see the same ticks and loot shortage") {
+            THEN("loot appears on the same ticks in the same amount") {
+                unsigned loot = 0;
+                unsigned looters = 2;
+                int64_t pending_ms = 0;
+
+                for (int tick = 0; tick < 20000; ++tick) {
+                    const TimeInterval delta{tick_dist(rng)};
+
+                    // Note: shortage changes from time to time, like joins and gathering do
+                    if (tick % 500 == 0) {
+                        looters = looters_dist(rng);
+                        loot = std::min(loot, looters);
+                    }
+
+                    const unsigned expected = polled.Generate(delta, loot, looters);
+
+                    unsigned actual = 0;
+                    pending_ms += delta.count();
+                    if (auto wait = scheduled.TimeUntilLoot(loot, looters); wait && pending_ms >= wait->count()) {
+                        actual = scheduled.Generate(TimeInterval{pending_ms}, loot, looters);
+                        pending_ms = 0;
+                    }
+
+                    INFO("tick: " << tick);
+                    REQUIRE(actual == expected);
+
+                    loot += actual;
+                }
+            }
+        }
+    }
+
+    GIVEN("no loot shortage") {
+        LootGenerator gen{1s, 0.5};
+
+        THEN("loot is never expected") {
+            REQUIRE_FALSE(gen.TimeUntilLoot(3, 3).has_value());
+            REQUIRE_FALSE(gen.TimeUntilLoot(4, 0).has_value());
+        }
+    }
+
+    GIVEN("a custom random generator") {
+        LootGenerator gen{1s, 0.5, [] {
+                              return 0.5;
+                          }};
+
+        THEN("spawn time is unknown and the generator has to be polled") {
+            REQUIRE(gen.TimeUntilLoot(0, 4) == TimeInterval::zero());
+        }
+    }
+}
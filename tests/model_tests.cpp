@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/model.h"
+
+using namespace std::string_literals;
+using namespace model;
+
+namespace
+{
+    const Map::Id MAP_ID{"m"s};
+
+    void AddMap(Game & game, double road_length = 100) {
+        Map map(MAP_ID, "m"s);
+        map.AddRoad(Road(Road::HORIZONTAL, {0, 0}, road_length));
+        game.AddMap(std::move(map));
+    }
+}
+
+SCENARIO("Session hibernation")
+{
+    Game game;
+    game.SetSessionGracePeriod(5000);
+    game.SetDogRetirementTime(2.0);
+    AddMap(game);
+
+    GIVEN("a session with one player") {
+        auto * player = game.Join("a", MAP_ID);
+        auto * session = &player->GetGameSession();
+
+        REQUIRE(game.GetSessionsCount() == 1);
+        REQUIRE(game.GetAwakeSessionsCount() == 1);
+        REQUIRE(!session->IsHibernating());
+
+        WHEN("the player leaves") {
+            game.RemovePlayerByToken(player->GetToken());
+
+            THEN("the session hibernates and is not ticked") {
+                REQUIRE(game.GetSessionsCount() == 1);
+                REQUIRE(game.GetAwakeSessionsCount() == 0);
+                REQUIRE(session->IsHibernating());
+            }
+
+            AND_WHEN("somebody joins within the grace period") {
+                game.Think(4000);
+                REQUIRE(game.GetSessionsCount() == 1);
+
+                auto * next = game.Join("b", MAP_ID);
+
+                THEN("the same session wakes up") {
+                    REQUIRE(&next->GetGameSession() == session);
+                    REQUIRE(!session->IsHibernating());
+                    REQUIRE(game.GetAwakeSessionsCount() == 1);
+                }
+
+                THEN("it is not reclaimed while it has players") {
+                    game.Think(10000);
+                    REQUIRE(game.GetSessionsCount() == 1);
+                }
+            }
+
+            AND_WHEN("nobody joins within the grace period") {
+                game.Think(4000);
+                REQUIRE(game.GetSessionsCount() == 1);
+                game.Think(2000);
+
+                THEN("the session is freed") {
+                    REQUIRE(game.GetSessionsCount() == 0);
+                    REQUIRE(game.GetAwakeSessionsCount() == 0);
+                }
+
+                THEN("a later join gets a new session") {
+                    auto * next = game.Join("c", MAP_ID);
+                    REQUIRE(game.GetSessionsCount() == 1);
+                    REQUIRE(game.GetAwakeSessionsCount() == 1);
+                    REQUIRE(game.FindPlayerByToken(next->GetToken()) == next);
+                }
+            }
+        }
+
+        WHEN("the player retires and is removed") {
+            auto retired = game.Think(3000);
+            REQUIRE(retired.size() == 1);
+            REQUIRE(*retired.front() == player->GetToken());
+
+            game.RemovePlayerByToken(player->GetToken());
+
+            THEN("the session hibernates as well") {
+                REQUIRE(game.GetAwakeSessionsCount() == 0);
+                REQUIRE(game.FindPlayerByToken(player->GetToken()) == nullptr);
+            }
+        }
+    }
+}
+
+SCENARIO("Player and dog lifecycle")
+{
+    Game game;
+    AddMap(game);
+
+    GIVEN("three moving players in one session") {
+        auto * a = game.Join("a", MAP_ID);
+        auto * b = game.Join("b", MAP_ID);
+        auto * c = game.Join("c", MAP_ID);
+        auto & session = a->GetGameSession();
+
+        for (auto * p : { a, b, c })
+            p->SetDirection("R", 1.0f);
+
+        REQUIRE(session.GetActivePlayersCount() == 3);
+
+        WHEN("the player in the middle of the active set leaves") {
+            game.RemovePlayerByToken(b->GetToken());
+
+            THEN("the others stay in the active set and keep moving") {
+                REQUIRE(session.GetActivePlayersCount() == 2);
+                REQUIRE(session.GetPlayersCount() == 2);
+                REQUIRE(session.GetDogs().size() == 2);
+
+                const auto a_start = a->GetPosition().x;
+                const auto c_start = c->GetPosition().x;
+                game.Think(1000);
+
+                REQUIRE(session.GetDogMoves().size() == 2);
+                REQUIRE(a->GetPosition().x > a_start);
+                REQUIRE(c->GetPosition().x > c_start);
+            }
+
+            AND_WHEN("the last one of the active set stops") {
+                // Note: c was moved into the slot of b
+                c->SetDirection("", 0.0f);
+
+                THEN("only the remaining one moves") {
+                    REQUIRE(session.GetActivePlayersCount() == 1);
+
+                    game.Think(1000);
+                    REQUIRE(session.GetDogMoves().size() == 1);
+                    REQUIRE(session.GetDogMoves().front().dog == a->GetDog());
+                }
+            }
+        }
+
+        WHEN("the first player leaves") {
+            game.RemovePlayerByToken(a->GetToken());
+
+            THEN("the dogs left are those of the players left") {
+                const auto & dogs = session.GetDogs();
+                REQUIRE(dogs.size() == 2);
+                for (auto * p : { b, c }) {
+                    REQUIRE(std::ranges::any_of(dogs, [p](const auto & dog) {
+                        return dog.get() == p->GetDog();
+                    }));
+                }
+            }
+        }
+    }
+
+    GIVEN("a session under player churn") {
+        auto * keep = game.Join("keep", MAP_ID);
+        keep->SetDirection("R", 1.0f);
+
+        for (int i = 0; i < 10000; ++i) {
+            auto * p = game.Join("x", MAP_ID);
+            p->SetDirection(i % 2 ? "L" : "R", 1.0f);
+            if (i % 10 == 0)
+                game.Think(10);
+            game.RemovePlayerByToken(p->GetToken());
+        }
+
+        THEN("memory is bounded by the live players") {
+            const auto & session = keep->GetGameSession();
+            REQUIRE(session.GetPlayersCount() == 1);
+            REQUIRE(session.GetActivePlayersCount() == 1);
+            REQUIRE(session.GetDogs().size() == 1);
+            REQUIRE(session.GetDogs().front().get() == keep->GetDog());
+        }
+    }
+}
+
+SCENARIO("Session shards")
+{
+    Game game;
+    game.SetSessionGracePeriod(5000);
+    game.SetMaxPlayersPerSession(3);
+    AddMap(game);
+
+    GIVEN("more players than one session holds") {
+        std::vector<Player *> players;
+        for (int i = 0; i < 7; ++i)
+            players.push_back(game.Join("p" + std::to_string(i), MAP_ID));
+
+        THEN("they are spread over sessions within the capacity") {
+            REQUIRE(game.GetSessionsCount() == 3);
+            for (auto * p : players)
+                REQUIRE(p->GetGameSession().GetPlayersCount() <= 3);
+
+            REQUIRE(&players[0]->GetGameSession() == &players[2]->GetGameSession());
+            REQUIRE(&players[0]->GetGameSession() != &players[3]->GetGameSession());
+        }
+
+        WHEN("the first session is emptied") {
+            auto * first = &players[0]->GetGameSession();
+            for (int i = 0; i < 3; ++i)
+                game.RemovePlayerByToken(players[i]->GetToken());
+
+            THEN("a new player goes to the least loaded session instead of a new one") {
+                auto * p = game.Join("late", MAP_ID);
+                REQUIRE(&p->GetGameSession() == first);
+                REQUIRE(game.GetSessionsCount() == 3);
+                REQUIRE(!first->IsHibernating());
+            }
+        }
+
+        WHEN("all players leave") {
+            for (auto * p : players)
+                game.RemovePlayerByToken(p->GetToken());
+
+            THEN("every session is freed after the grace period") {
+                REQUIRE(game.GetAwakeSessionsCount() == 0);
+                game.Think(5000);
+                REQUIRE(game.GetSessionsCount() == 0);
+            }
+        }
+    }
+}
+
+SCENARIO("Spawn points for a join storm")
+{
+    auto setup = [](Game & game) {
+        game.SetRandomizeSpawnPoints(true);
+        game.SetRandomSeed(5);
+        game.SetMaxPlayersPerSession(500);
+
+        Map map(MAP_ID, "m"s);
+        map.AddRoad(Road(Road::HORIZONTAL, {0, 0}, 100));
+        map.AddRoad(Road(Road::VERTICAL, {100, 0}, 100));
+        game.AddMap(std::move(map));
+    };
+
+    // Note: more joins than the spawn pool of a session holds, so pools are refilled in the middle of the batch
+    std::vector<std::string> names(1200, "p"s);
+
+    GIVEN("a batch of joins to a map with randomized spawn points") {
+        Game game;
+        setup(game);
+        auto & map = *game.FindMap(MAP_ID);
+        const auto players = game.JoinMany(names, map);
+
+        THEN("the batch is sharded and every dog is placed on a road") {
+            REQUIRE(players.size() == names.size());
+            REQUIRE(game.GetSessionsCount() == 3);
+
+            for (auto * p : players)
+                REQUIRE(map.IsPositionOnRoad(p->GetPosition()));
+        }
+
+        THEN("the same seed gives the same spawn points") {
+            Game other;
+            setup(other);
+            const auto other_players = other.JoinMany(names, *other.FindMap(MAP_ID));
+
+            REQUIRE(other_players.size() == players.size());
+            for (size_t i = 0; i < players.size(); ++i)
+                REQUIRE(players[i]->GetPosition() == other_players[i]->GetPosition());
+        }
+    }
+}
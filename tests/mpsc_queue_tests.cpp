@@ -0,0 +1,67 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/mpsc_queue.h"
+
+SCENARIO("MPSC queue")
+{
+    GIVEN("an empty queue") {
+        util::MpscQueue<std::string> queue;
+
+        THEN("drain does nothing") {
+            REQUIRE(queue.Empty());
+            REQUIRE(queue.Drain([](std::string &&) { FAIL(); }) == 0);
+        }
+
+        WHEN("values are pushed from one thread") {
+            queue.Push("a");
+            queue.Push("b");
+            queue.Push("c");
+
+            THEN("they are drained in push order") {
+                std::vector<std::string> drained;
+                REQUIRE(queue.Drain([&](std::string && s) { drained.push_back(std::move(s)); }) == 3);
+                REQUIRE(drained == std::vector<std::string>{"a", "b", "c"});
+                REQUIRE(queue.Empty());
+            }
+        }
+    }
+
+    GIVEN("several producers and a concurrent consumer") {
+        constexpr int NUM_PRODUCERS = 4;
+        constexpr int NUM_ITEMS     = 20000;
+
+        util::MpscQueue<std::pair<int, int>> queue;
+        std::vector<int> last(NUM_PRODUCERS, -1);
+        int drained = 0;
+        bool ordered = true;
+
+        auto consume = [&](std::pair<int, int> && item) {
+            ordered = ordered && item.second == last[item.first] + 1;
+            last[item.first] = item.second;
+            ++drained;
+        };
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < NUM_PRODUCERS; ++p) {
+            producers.emplace_back([&queue, p] {
+                for (int i = 0; i < NUM_ITEMS; ++i)
+                    queue.Push({p, i});
+            });
+        }
+
+        while (drained < NUM_PRODUCERS * NUM_ITEMS / 2)
+            queue.Drain(consume);
+
+        for (auto & t : producers)
+            t.join();
+        queue.Drain(consume);
+
+        THEN("nothing is lost and every producer keeps its order") {
+            REQUIRE(drained == NUM_PRODUCERS * NUM_ITEMS);
+            REQUIRE(ordered);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/random.h"
+
+SCENARIO("Seeded random generator")
+{
+    GIVEN("two generators with the same seed") {
+        util::Xoshiro256 a{12345};
+        util::Xoshiro256 b{12345};
+
+        THEN("they produce the same sequence") {
+            for (int i = 0; i < 1000; ++i)
+                REQUIRE(a() == b());
+        }
+    }
+
+    GIVEN("two generators with different seeds") {
+        util::Xoshiro256 a{1};
+        util::Xoshiro256 b{2};
+
+        THEN("sequences differ") {
+            int equal = 0;
+            for (int i = 0; i < 1000; ++i)
+                equal += a() == b() ? 1 : 0;
+
+            REQUIRE(equal == 0);
+        }
+    }
+
+    GIVEN("a generator") {
+        util::Xoshiro256 rng{7};
+
+        THEN("doubles and indices stay in range") {
+            for (int i = 0; i < 10000; ++i) {
+                const double d = rng.NextDouble();
+                REQUIRE(d >= 0.0);
+                REQUIRE(d < 1.0);
+                REQUIRE(rng.NextIndex(13) < 13);
+            }
+        }
+    }
+}
+
+SCENARIO("Alias table")
+{
+    util::Xoshiro256 rng{42};
+
+    GIVEN("weighted items") {
+        const std::vector<double> weights = {1.0, 0.0, 3.0, 6.0};
+        util::AliasTable table{weights};
+
+        WHEN("many samples are taken") {
+            constexpr int NUM_SAMPLES = 200000;
+            std::vector<int> hits(weights.size(), 0);
+
+            for (int i = 0; i < NUM_SAMPLES; ++i)
+                ++hits[table.Sample(rng)];
+
+            THEN("frequencies follow weights") {
+                REQUIRE(hits[1] == 0);
+
+                for (size_t i = 0; i < weights.size(); ++i) {
+                    const double expected = weights[i] / 10.0;
+                    const double actual   = static_cast<double>(hits[i]) / NUM_SAMPLES;
+                    INFO("item: " << i);
+                    CHECK(std::abs(actual - expected) < 0.01);
+                }
+            }
+        }
+    }
+
+    GIVEN("a single item") {
+        util::AliasTable table{std::vector<double>{5.0}};
+
+        THEN("it is always chosen") {
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(table.Sample(rng) == 0);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/game_db.h"
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace
+{
+    // Hex encoding of raw, as the cursor stores it
+    std::string Hex(std::string_view raw) {
+        constexpr std::string_view HEX = "0123456789abcdef"sv;
+
+        std::string ret;
+        for (unsigned char c : raw) {
+            ret += HEX[c >> 4];
+            ret += HEX[c & 0x0F];
+        }
+        return ret;
+    }
+}
+
+SCENARIO("Records cursor")
+{
+    GIVEN("a record") {
+        db::RecordItem item{ .id = "6f1d3c1e-93a1-4c27-9d3b-0a6c2b1f5e42"s,
+                             .name = "a:b\tc \xd0\xaf"s,
+                             .score = 42,
+                             .play_time_ms = 123456 };
+
+        WHEN("it is encoded into a cursor") {
+            const auto cursor = db::EncodeRecordCursor(item);
+
+            THEN("the cursor is opaque lowercase hex") {
+                REQUIRE(cursor.find_first_not_of("0123456789abcdef"sv) == std::string::npos);
+            }
+
+            THEN("decoding gives the same sort keys back") {
+                // Note: the name may contain ':', it is the last field and is taken as the rest
+                auto decoded = db::DecodeRecordCursor(cursor);
+                REQUIRE(decoded);
+                REQUIRE(decoded->id == item.id);
+                REQUIRE(decoded->name == item.name);
+                REQUIRE(decoded->score == item.score);
+                REQUIRE(decoded->play_time_ms == item.play_time_ms);
+            }
+        }
+
+        WHEN("its name is empty") {
+            item.name.clear();
+
+            THEN("it survives the round trip as well") {
+                auto decoded = db::DecodeRecordCursor(db::EncodeRecordCursor(item));
+                REQUIRE(decoded);
+                REQUIRE(decoded->name.empty());
+                REQUIRE(decoded->id == item.id);
+            }
+        }
+    }
+
+    GIVEN("malformed hex") {
+        THEN("it is rejected") {
+            REQUIRE(!db::DecodeRecordCursor(""sv));
+            REQUIRE(!db::DecodeRecordCursor("313"sv));          // odd length
+            REQUIRE(!db::DecodeRecordCursor("3g3a"sv));         // not a hex digit
+            REQUIRE(!db::DecodeRecordCursor("0x3a"sv));
+            REQUIRE(!db::DecodeRecordCursor("+1-1"sv));
+        }
+    }
+
+    GIVEN("well-formed hex with a bad payload") {
+        THEN("it is rejected") {
+            REQUIRE(!db::DecodeRecordCursor(Hex("10:20:id"sv)));        // no name field
+            REQUIRE(!db::DecodeRecordCursor(Hex("ten:20:id:name"sv)));
+            REQUIRE(!db::DecodeRecordCursor(Hex("10:20ms:id:name"sv)));
+            REQUIRE(!db::DecodeRecordCursor(Hex(":20:id:name"sv)));
+            REQUIRE(!db::DecodeRecordCursor(Hex("99999999999:20:id:name"sv)));  // score out of int range
+        }
+
+        THEN("a payload of the right shape is accepted") {
+            auto decoded = db::DecodeRecordCursor(Hex("10:20:id:name"sv));
+            REQUIRE(decoded);
+            REQUIRE(decoded->score == 10);
+            REQUIRE(decoded->play_time_ms == 20);
+            REQUIRE(decoded->id == "id"sv);
+            REQUIRE(decoded->name == "name"sv);
+        }
+    }
+}
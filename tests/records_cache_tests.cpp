@@ -0,0 +1,145 @@
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/records_cache.h"
+
+using db::RecordItem;
+using db::RecordItems;
+using db::RecordsCache;
+
+namespace
+{
+    RecordItem Record(std::string id, std::string name, int score, int64_t play_time_ms) {
+        return { .id = std::move(id), .name = std::move(name), .score = score, .play_time_ms = play_time_ms };
+    }
+
+    std::string Ids(const RecordItems & items) {
+        std::string ret;
+        for (const auto & item : items)
+            ret += item.id;
+        return ret;
+    }
+}
+
+SCENARIO("Records cache")
+{
+    GIVEN("records which differ in each of the sort keys") {
+        RecordsCache cache(10);
+        cache.Load({
+            Record("e", "bob",    10, 500),
+            Record("a", "alice",  30, 900),
+            Record("d", "bob",    10, 100),
+            Record("c", "Bob",    10, 500),
+            Record("b", "zed",    20, 100),
+            Record("f", "bob",    10, 500),
+        });
+
+        THEN("they are ordered by score DESC, play time, bytewise name and id") {
+            auto page = cache.GetPage({});
+            REQUIRE(page);
+            // Note: 'B' < 'b' in the C collation
+            REQUIRE(Ids(*page) == "abdcef");
+        }
+
+        THEN("a page after a cursor starts right after that record") {
+            auto page = cache.GetPage({ .after = Record("c", "Bob", 10, 500), .maxItems = 2 });
+            REQUIRE(page);
+            REQUIRE(Ids(*page) == "ef");
+        }
+
+        THEN("an offset page is cut at the end of the table") {
+            auto page = cache.GetPage({ .start = 4, .maxItems = 10 });
+            REQUIRE(page);
+            REQUIRE(Ids(*page) == "ef");
+
+            page = cache.GetPage({ .start = 20, .maxItems = 10 });
+            REQUIRE(page);
+            REQUIRE(page->empty());
+        }
+    }
+
+    GIVEN("a cache loaded with as many records as its depth") {
+        RecordsCache cache(3);
+        cache.Load({ Record("a", "a", 30, 0), Record("b", "b", 20, 0), Record("c", "c", 10, 0) });
+
+        THEN("pages within the depth are served") {
+            auto page = cache.GetPage({ .start = 1, .maxItems = 2 });
+            REQUIRE(page);
+            REQUIRE(Ids(*page) == "bc");
+        }
+
+        THEN("a page reaching past the depth goes to the storage") {
+            // Note: the table may hold more rows than were fetched
+            REQUIRE(!cache.GetPage({ .start = 2, .maxItems = 2 }));
+            REQUIRE(!cache.GetPage({ .after = Record("c", "c", 10, 0), .maxItems = 1 }));
+        }
+
+        WHEN("a better record is inserted") {
+            cache.Insert(Record("x", "x", 25, 0));
+
+            THEN("it takes its place and the last record is evicted") {
+                auto page = cache.GetPage({ .maxItems = 3 });
+                REQUIRE(page);
+                REQUIRE(Ids(*page) == "axb");
+            }
+        }
+
+        WHEN("a record below the cached top is inserted") {
+            cache.Insert(Record("y", "y", 1, 0));
+
+            THEN("it is not cached") {
+                auto page = cache.GetPage({ .maxItems = 3 });
+                REQUIRE(page);
+                REQUIRE(Ids(*page) == "abc");
+                REQUIRE(!cache.GetPage({ .start = 3, .maxItems = 1 }));
+            }
+        }
+    }
+
+    GIVEN("a cache of a table shorter than its depth") {
+        RecordsCache cache(3);
+        cache.Load({ Record("a", "a", 30, 0) });
+
+        WHEN("records are inserted up to the depth") {
+            cache.Insert(Record("b", "b", 20, 0));
+            cache.Insert(Record("c", "c", 10, 0));
+
+            THEN("it still holds the whole table") {
+                auto page = cache.GetPage({ .start = 0, .maxItems = 10 });
+                REQUIRE(page);
+                REQUIRE(Ids(*page) == "abc");
+            }
+
+            AND_WHEN("one more record overflows it") {
+                cache.Insert(Record("d", "d", 40, 0));
+
+                THEN("the evicted tail is left to the storage") {
+                    auto page = cache.GetPage({ .maxItems = 3 });
+                    REQUIRE(page);
+                    REQUIRE(Ids(*page) == "dab");
+                    REQUIRE(!cache.GetPage({ .start = 0, .maxItems = 10 }));
+                }
+            }
+        }
+    }
+
+    GIVEN("the version used as the ETag of the leaderboard") {
+        RecordsCache cache(3);
+        const auto initial = cache.GetVersion();
+
+        THEN("it changes on load and on every insert") {
+            cache.Load({});
+            const auto loaded = cache.GetVersion();
+            REQUIRE(loaded != initial);
+
+            cache.Insert(Record("a", "a", 1, 0));
+            REQUIRE(cache.GetVersion() != loaded);
+        }
+
+        THEN("reads do not change it") {
+            const auto before = cache.GetVersion();
+            (void)cache.GetPage({});
+            REQUIRE(cache.GetVersion() == before);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include <array>
+#include <string_view>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/route_trie.h"
+
+using namespace std::string_view_literals;
+
+namespace
+{
+    constexpr std::array ROUTES = {
+        "maps"sv,
+        "maps/{id}"sv,
+        "game/join"sv,
+        "game/join/batch"sv,
+        "game/player/action"sv,
+        "game/player/*"sv,
+        "game/*"sv,
+        "users/{user}/items/{item}"sv,
+    };
+
+    constexpr util::RouteTrie<16> TRIE{ROUTES};
+
+    // Note: the trie is built and searched at compile time
+    static_assert(TRIE.Find("game/join/batch"sv)->route == 3);
+    static_assert(TRIE.Find("maps/map1"sv)->params[0] == "map1"sv);
+
+    constexpr std::array SHADOWED_ROUTES = {
+        "users/me/profile"sv,
+        "users/{id}/items"sv,
+        "users/*"sv,
+    };
+
+    constexpr util::RouteTrie<8> SHADOWED_TRIE{SHADOWED_ROUTES};
+
+    // Note: "me" matches the exact segment first, the rest of the path is only found under {id}
+    static_assert(SHADOWED_TRIE.Find("users/me/items"sv)->route == 1);
+}
+
+SCENARIO("Route trie")
+{
+    GIVEN("a trie built from a route table") {
+        THEN("exact routes are found") {
+            REQUIRE(TRIE.Find("maps"sv)->route == 0);
+            REQUIRE(TRIE.Find("game/join"sv)->route == 2);
+            REQUIRE(TRIE.Find("game/join/batch"sv)->route == 3);
+            REQUIRE(TRIE.Find("game/player/action"sv)->route == 4);
+        }
+
+        THEN("parameters are captured") {
+            auto match = TRIE.Find("maps/town"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 1);
+            REQUIRE(match->param_count == 1);
+            REQUIRE(match->params[0] == "town"sv);
+
+            match = TRIE.Find("users/42/items/7"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 7);
+            REQUIRE(match->param_count == 2);
+            REQUIRE(match->params[0] == "42"sv);
+            REQUIRE(match->params[1] == "7"sv);
+        }
+
+        THEN("an empty segment is a parameter value too") {
+            auto match = TRIE.Find("maps/"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 1);
+            REQUIRE(match->params[0].empty());
+        }
+
+        THEN("unknown paths fall back to the nearest '*'") {
+            auto match = TRIE.Find("game/player/move"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 5);
+            REQUIRE(match->rest == "move"sv);
+
+            match = TRIE.Find("game/join/"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 6);
+            REQUIRE(match->rest == "join/"sv);
+
+            match = TRIE.Find("game/state"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 6);
+        }
+
+        THEN("a fallback does not keep parameters of the abandoned branch") {
+            auto match = TRIE.Find("users/42/orders"sv);
+            REQUIRE(!match);
+        }
+
+        THEN("paths without a route are not found") {
+            REQUIRE(!TRIE.Find(""sv));
+            REQUIRE(!TRIE.Find("game"sv));
+            REQUIRE(!TRIE.Find("mapsX"sv));
+            REQUIRE(!TRIE.Find("maps/town/roads"sv));
+            REQUIRE(!TRIE.Find("/maps"sv));
+        }
+    }
+
+    GIVEN("an exact segment which shadows a parameter") {
+        THEN("the exact branch is taken when the path continues in it") {
+            auto match = SHADOWED_TRIE.Find("users/me/profile"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 0);
+            REQUIRE(match->param_count == 0);
+        }
+
+        THEN("a dead end in the exact branch falls back to the parameter") {
+            auto match = SHADOWED_TRIE.Find("users/me/items"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 1);
+            REQUIRE(match->param_count == 1);
+            REQUIRE(match->params[0] == "me"sv);
+        }
+
+        THEN("a path found in neither branch falls back to the '*' without parameters") {
+            auto match = SHADOWED_TRIE.Find("users/me/orders"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 2);
+            REQUIRE(match->param_count == 0);
+            REQUIRE(match->params[0].empty());
+            REQUIRE(match->rest == "me/orders"sv);
+
+            match = SHADOWED_TRIE.Find("users/me"sv);
+            REQUIRE(match);
+            REQUIRE(match->route == 2);
+            REQUIRE(match->rest == "me"sv);
+        }
+    }
+
+    GIVEN("a conflicting route table") {
+        THEN("building the trie fails") {
+            REQUIRE_THROWS(util::RouteTrie<8>(std::array{"maps"sv, "maps"sv}));
+            REQUIRE_THROWS(util::RouteTrie<8>(std::array{"game/*/join"sv}));
+            REQUIRE_THROWS(util::RouteTrie<2>(std::array{"game/join/batch"sv}));
+            REQUIRE_THROWS(util::RouteTrie<8, 1>(std::array{"{a}/{b}"sv}));
+        }
+    }
+}
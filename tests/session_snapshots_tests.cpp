@@ -0,0 +1,109 @@
+#include <chrono>
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/session_snapshots.h"
+
+using namespace std::string_literals;
+
+namespace
+{
+    void AddMap(model::Game & game, const std::string & id) {
+        model::Map map(model::Map::Id{id}, id);
+        map.AddRoad(model::Road(model::Road::HORIZONTAL, {0, 0}, 10));
+        game.AddMap(std::move(map));
+    }
+
+    // Past deadline, every step serializes exactly one session
+    bool PublishOne(app::SessionSnapshots & snapshots) {
+        return snapshots.PublishStep(model::Clock::now() - std::chrono::seconds(1));
+    }
+}
+
+SCENARIO("Session snapshots")
+{
+    model::Game game;
+    AddMap(game, "m1"s);
+    AddMap(game, "m2"s);
+    AddMap(game, "m3"s);
+
+    auto & s1 = game.Join("a", model::Map::Id{"m1"s})->GetGameSession();
+    auto & s2 = game.Join("b", model::Map::Id{"m2"s})->GetGameSession();
+
+    app::SessionSnapshots snapshots;
+
+    GIVEN("a table being built in steps") {
+        snapshots.BeginPublishAll({ &s1, &s2 });
+        REQUIRE(snapshots.IsPublishing());
+
+        REQUIRE(!PublishOne(snapshots));
+
+        THEN("readers do not see a half-built table") {
+            REQUIRE(!snapshots.Find(s1.GetId()));
+            REQUIRE(!snapshots.Find(s2.GetId()));
+        }
+
+        WHEN("a player joins another map before the table is complete") {
+            auto * p3 = game.Join("c", model::Map::Id{"m3"s});
+            auto & s3 = p3->GetGameSession();
+            snapshots.Publish(s3);
+
+            THEN("the session is queued into the table, not published aside") {
+                REQUIRE(!snapshots.Find(s3.GetId()));
+            }
+
+            AND_WHEN("the table is complete") {
+                int steps = 0;
+                while (!PublishOne(snapshots))
+                    ++steps;
+
+                THEN("every session is published at once, the joined one included") {
+                    REQUIRE(!snapshots.IsPublishing());
+                    REQUIRE(steps == 2);
+
+                    REQUIRE(snapshots.Find(s1.GetId()));
+                    REQUIRE(snapshots.Find(s2.GetId()));
+
+                    auto snapshot = snapshots.Find(s3.GetId());
+                    REQUIRE(snapshot);
+                    REQUIRE(snapshot->HasPlayer(p3->GetId()));
+                    REQUIRE(!snapshot->state_body.empty());
+                    REQUIRE(!snapshot->players_body.empty());
+                }
+            }
+        }
+    }
+
+    GIVEN("a published table") {
+        snapshots.BeginPublishAll({ &s1, &s2 });
+        REQUIRE(snapshots.PublishStep(model::TimePoint::max()));
+
+        const auto old1 = snapshots.Find(s1.GetId());
+        const auto old2 = snapshots.Find(s2.GetId());
+        REQUIRE(old1);
+        REQUIRE(old2);
+
+        WHEN("one session is published") {
+            snapshots.Publish(s1);
+
+            THEN("only its snapshot is replaced") {
+                REQUIRE(snapshots.Find(s1.GetId()) != old1);
+                REQUIRE(snapshots.Find(s2.GetId()) == old2);
+            }
+
+            THEN("a reader keeps the snapshot it has taken") {
+                REQUIRE(old1->HasPlayer(s1.GetPlayers().front()->GetId()));
+            }
+        }
+
+        WHEN("the next table leaves a session out") {
+            snapshots.BeginPublishAll({ &s2 });
+            REQUIRE(snapshots.PublishStep(model::TimePoint::max()));
+
+            THEN("its snapshot is dropped") {
+                REQUIRE(!snapshots.Find(s1.GetId()));
+                REQUIRE(snapshots.Find(s2.GetId()));
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/lib/thread_pool.h"
+
+using namespace util;
+
+
+TEST_CASE("ThreadPool ParallelFor covers the range once")
+{
+    for (size_t threads : { 0, 1, 3 }) {
+        ThreadPool pool(threads);
+        CHECK(pool.GetConcurrency() == threads + 1);
+
+        for (size_t count : { 0, 1, 7, 10000 }) {
+            std::vector<int> hits(count, 0);
+            pool.ParallelFor(count, [&hits](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    ++hits[i];
+            });
+            CHECK(std::accumulate(hits.begin(), hits.end(), size_t{0}) == count);
+            CHECK(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+        }
+    }
+}
+
+TEST_CASE("ThreadPool ParallelFor rethrows and stays usable")
+{
+    ThreadPool pool(2);
+
+    CHECK_THROWS_AS(pool.ParallelFor(100, [](size_t begin, size_t end) {
+        if (begin <= 50 && 50 < end)
+            throw std::runtime_error("range failed");
+    }), std::runtime_error);
+
+    std::atomic<size_t> total = 0;
+    for (int round = 0; round < 100; ++round)
+        pool.ParallelFor(1000, [&total](size_t begin, size_t end) {
+            total += end - begin;
+        });
+    CHECK(total == 100000);
+}
@@ -0,0 +1,115 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/tick_slicer.h"
+
+using namespace std::chrono_literals;
+using app::TickSlicer;
+
+namespace
+{
+    // Records the calls the slicer makes to the game
+    struct FakeGame
+    {
+        std::vector<std::chrono::milliseconds> begins;
+        int steps = 0;
+        int done = 0;
+        // Note: the number of step calls a tick takes to complete
+        int steps_per_tick = 1;
+        int steps_in_tick = 0;
+    };
+
+    std::shared_ptr<TickSlicer> MakeSlicer(std::shared_ptr<app::PriorityDispatcher> dispatcher,
+                                           TickSlicer::Clock::duration budget,
+                                           app::LoadController & load_controller,
+                                           FakeGame & game) {
+        return std::make_shared<TickSlicer>(std::move(dispatcher), budget, load_controller,
+            [&game](std::chrono::milliseconds elapsed) {
+                game.begins.push_back(elapsed);
+                game.steps_in_tick = 0;
+            },
+            [&game](TickSlicer::Clock::time_point) {
+                ++game.steps;
+                return ++game.steps_in_tick >= game.steps_per_tick;
+            },
+            [&game] {
+                ++game.done;
+            });
+    }
+}
+
+SCENARIO("Tick slicer")
+{
+    boost::asio::io_context ioc;
+    auto strand = boost::asio::make_strand(ioc);
+    auto dispatcher = std::make_shared<app::PriorityDispatcher>(strand);
+    app::LoadController load_controller(10ms);
+    FakeGame game;
+
+    GIVEN("a tick which takes several slices") {
+        game.steps_per_tick = 10;
+        auto slicer = MakeSlicer(dispatcher, 1us, load_controller, game);
+
+        int gameplay_at_step = 0;
+
+        WHEN("an API request arrives during the first slice") {
+            boost::asio::post(strand, [&] {
+                slicer->Tick(10ms);
+                REQUIRE(slicer->IsRunning());
+
+                dispatcher->Post(app::WorkClass::Gameplay, [&] {
+                    gameplay_at_step = game.steps;
+                });
+            });
+            ioc.run();
+
+            THEN("it runs between the slices, before the tick completes") {
+                REQUIRE(gameplay_at_step > 0);
+                REQUIRE(gameplay_at_step < game.steps_per_tick);
+            }
+
+            THEN("the tick completes once") {
+                REQUIRE(game.steps == game.steps_per_tick);
+                REQUIRE(game.done == 1);
+                REQUIRE(!slicer->IsRunning());
+                REQUIRE(slicer->GetStats().slices == static_cast<uint64_t>(game.steps_per_tick));
+                REQUIRE(load_controller.GetTickCount() == 1);
+            }
+        }
+
+        WHEN("the timer fires again while the tick is running") {
+            boost::asio::post(strand, [&] {
+                slicer->Tick(10ms);
+                slicer->Tick(7ms);
+            });
+            ioc.run();
+
+            THEN("the new time is simulated by the next tick before done is called") {
+                REQUIRE(game.begins == std::vector<std::chrono::milliseconds>{10ms, 7ms});
+                REQUIRE(game.done == 1);
+            }
+        }
+    }
+
+    GIVEN("a slicer without a budget") {
+        auto slicer = MakeSlicer(dispatcher, {}, load_controller, game);
+
+        WHEN("a coalesced tick covers more than the longest step") {
+            boost::asio::post(strand, [&] {
+                slicer->Tick(100ms);
+            });
+            ioc.run();
+
+            THEN("it is simulated in steps of at most the longest step, in one slice") {
+                REQUIRE(load_controller.GetMaxStep() == 40ms);
+                REQUIRE(game.begins == std::vector<std::chrono::milliseconds>{40ms, 40ms, 20ms});
+                REQUIRE(game.done == 1);
+                REQUIRE(slicer->GetStats().slices == 1);
+            }
+        }
+    }
+}
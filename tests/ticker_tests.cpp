@@ -0,0 +1,164 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/asio/post.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app/ticker.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Policy = model::Ticker::MissedTickPolicy;
+
+constexpr auto PERIOD = 20ms;
+// Note: half a period over the whole number keeps the count of missed periods away from a boundary
+constexpr auto STALL = 3 * PERIOD + PERIOD / 2;
+
+struct TickerRun
+{
+    std::vector<std::chrono::milliseconds> deltas;
+    model::Ticker::Stats stats;
+    model::Ticker::Clock::duration elapsed{};
+};
+
+// The handler of the first tick stalls for STALL, the rest return at once
+TickerRun RunStalled(Policy policy, size_t ticks)
+{
+    boost::asio::io_context ioc;
+    TickerRun run;
+
+    auto ticker = std::make_shared<model::Ticker>(boost::asio::make_strand(ioc), PERIOD,
+                                                  [&](std::chrono::milliseconds delta) {
+        run.deltas.push_back(delta);
+        if (run.deltas.size() == 1)
+            std::this_thread::sleep_for(STALL);
+        if (run.deltas.size() == ticks)
+            ioc.stop();
+    }, policy);
+
+    const auto started = model::Ticker::Clock::now();
+    ticker->Start();
+    ioc.run();
+
+    run.elapsed = model::Ticker::Clock::now() - started;
+    run.stats = ticker->GetStats();
+    return run;
+}
+
+}
+
+SCENARIO("Ticker missed tick policies")
+{
+    GIVEN("a handler which stalls for more than three periods once") {
+        constexpr size_t TICKS = 8;
+
+        WHEN("the policy is CatchUp") {
+            const auto run = RunStalled(Policy::CatchUp, TICKS);
+
+            THEN("every missed tick is run with a delta of one period") {
+                REQUIRE(run.deltas.size() == TICKS);
+                for (auto delta : run.deltas)
+                    CHECK(delta == PERIOD);
+
+                CHECK(run.stats.ticks == TICKS);
+                CHECK(run.stats.missed_ticks == 0);
+                // Note: the ticks after the stall are run back to back, at least the first is late
+                CHECK(run.stats.late_ticks >= 1);
+            }
+        }
+
+        WHEN("the policy is Skip") {
+            const auto run = RunStalled(Policy::Skip, TICKS);
+
+            THEN("the missed periods are dropped and counted") {
+                REQUIRE(run.deltas.size() == TICKS);
+                for (auto delta : run.deltas)
+                    CHECK(delta == PERIOD);
+
+                CHECK(run.stats.ticks == TICKS);
+                // Note: the deadline after the first tick is one period away, so one of the stalled periods is not missed
+                CHECK(run.stats.missed_ticks >= 2);
+                CHECK(run.stats.late_ticks >= 1);
+            }
+        }
+
+        WHEN("the policy is Coalesce") {
+            const auto run = RunStalled(Policy::Coalesce, TICKS);
+
+            THEN("the tick after the stall covers the stalled time") {
+                REQUIRE(run.deltas.size() == TICKS);
+                CHECK(run.deltas[1] >= STALL);
+
+                CHECK(run.stats.ticks == TICKS);
+                CHECK(run.stats.missed_ticks >= 2);
+                CHECK(run.stats.late_ticks >= 1);
+            }
+
+            THEN("the deltas add up to the scheduled time without drift") {
+                std::chrono::milliseconds total{};
+                for (auto delta : run.deltas)
+                    total += delta;
+
+                // Note: each tick fires at its deadline or later and the sub-millisecond remainder is carried,
+                // so the sum covers every scheduled period and never runs ahead of the clock
+                CHECK(total >= PERIOD * static_cast<int64_t>(run.stats.ticks + run.stats.missed_ticks));
+                CHECK(total <= run.elapsed);
+            }
+        }
+    }
+}
+
+SCENARIO("Ticker period change")
+{
+    GIVEN("a ticker whose period is changed after the next tick is armed") {
+        boost::asio::io_context ioc;
+        auto strand = boost::asio::make_strand(ioc);
+
+        std::vector<model::Ticker::Clock::time_point> fired;
+        std::shared_ptr<model::Ticker> ticker;
+        std::chrono::milliseconds new_period{};
+
+        auto run = [&](std::chrono::milliseconds period) {
+            ticker = std::make_shared<model::Ticker>(strand, period, [&](std::chrono::milliseconds) {
+                fired.push_back(model::Ticker::Clock::now());
+                // Note: posted, so it runs after OnTick has armed the timer, as a sliced tick does
+                if (fired.size() == 1)
+                    boost::asio::post(strand, [&] { ticker->SetPeriod(new_period); });
+                else
+                    ioc.stop();
+            }, Policy::Skip);
+
+            const auto started = model::Ticker::Clock::now();
+            ticker->Start();
+            ioc.run();
+            return started;
+        };
+
+        WHEN("the period is stretched") {
+            new_period = 60ms;
+            const auto started = run(5ms);
+
+            THEN("the armed tick waits for the new deadline") {
+                REQUIRE(fired.size() == 2);
+                CHECK(fired[1] - started >= 5ms + 60ms);
+                CHECK(ticker->GetPeriod() == 60ms);
+            }
+        }
+
+        WHEN("the period is shortened") {
+            new_period = 5ms;
+            const auto started = run(60ms);
+
+            THEN("the armed tick fires at the new deadline, not the old one") {
+                REQUIRE(fired.size() == 2);
+                CHECK(fired[1] - started >= 60ms + 5ms);
+                // Note: the old deadline is 120ms, the margin is wide for a loaded machine
+                CHECK(fired[1] - started < 110ms);
+            }
+        }
+    }
+}
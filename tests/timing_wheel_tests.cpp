@@ -0,0 +1,121 @@
+#include <map>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/timing_wheel.h"
+
+SCENARIO("Timing wheel")
+{
+    using Wheel = util::TimingWheel<int>;
+
+    GIVEN("an empty wheel") {
+        Wheel wheel;
+
+        WHEN("entries are inserted at different levels") {
+            const std::vector<uint64_t> deadlines = {1, 63, 64, 65, 4095, 4096, 4097, 300000, Wheel::MAX_DELTA + 1000};
+            for (size_t i = 0; i < deadlines.size(); ++i)
+                wheel.Insert(static_cast<int>(i), deadlines[i]);
+
+            THEN("every entry expires exactly at its deadline") {
+                std::vector<uint64_t> expired(deadlines.size(), 0);
+                uint64_t now = 0;
+
+                while (!wheel.Empty()) {
+                    now += 7;
+                    wheel.Advance(now, [&](int i) {
+                        expired[static_cast<size_t>(i)] = now;
+                    });
+                }
+
+                for (size_t i = 0; i < deadlines.size(); ++i) {
+                    INFO("deadline: " << deadlines[i]);
+                    CHECK(expired[i] >= deadlines[i]);
+                    CHECK(expired[i] < deadlines[i] + 7);
+                }
+            }
+        }
+
+        WHEN("an entry is removed") {
+            auto h1 = wheel.Insert(1, 100);
+            wheel.Insert(2, 100);
+            auto h3 = wheel.Insert(3, 100000);
+            wheel.Remove(h1);
+            wheel.Remove(h3);
+
+            THEN("it never expires") {
+                std::vector<int> expired;
+                wheel.Advance(200000, [&](int i) {
+                    expired.push_back(i);
+                });
+
+                REQUIRE(expired == std::vector<int>{2});
+                REQUIRE(wheel.Empty());
+            }
+        }
+
+        WHEN("an entry is inserted in the past") {
+            wheel.Advance(1000, [](int) {});
+            wheel.Insert(1, 10);
+
+            THEN("it expires on the next advance") {
+                int count = 0;
+                wheel.Advance(1001, [&](int) {
+                    ++count;
+                });
+
+                REQUIRE(count == 1);
+            }
+        }
+    }
+
+    GIVEN("a wheel with coarse resolution") {
+        Wheel wheel{50};
+        wheel.Insert(1, 120);
+
+        THEN("deadline is rounded up to the wheel tick") {
+            int count = 0;
+            wheel.Advance(149, [&](int) { ++count; });
+            REQUIRE(count == 0);
+
+            wheel.Advance(150, [&](int) { ++count; });
+            REQUIRE(count == 1);
+        }
+    }
+
+    GIVEN("random insertions and removals") {
+        Wheel wheel;
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<uint64_t> dist(1, 1'000'000);
+
+        std::map<int, std::pair<uint64_t, Wheel::Handle>> pending;
+        for (int i = 0; i < 2000; ++i) {
+            uint64_t deadline = dist(rng);
+            pending.emplace(i, std::make_pair(deadline, wheel.Insert(i, deadline)));
+        }
+
+        for (int i = 0; i < 2000; i += 3) {
+            wheel.Remove(pending.at(i).second);
+            pending.erase(i);
+        }
+
+        THEN("expiration order matches deadlines") {
+            uint64_t now = 0;
+            size_t expired = 0;
+
+            while (now < 1'000'000) {
+                now += 997;
+                wheel.Advance(now, [&](int i) {
+                    auto it = pending.find(i);
+                    REQUIRE(it != pending.end());
+                    CHECK(it->second.first <= now);
+                    CHECK(it->second.first > now - 997);
+                    ++expired;
+                });
+            }
+
+            REQUIRE(expired == pending.size());
+            REQUIRE(wheel.Empty());
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include <array>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/lib/weighted_fair_queue.h"
+
+SCENARIO("Weighted fair queue")
+{
+    GIVEN("a queue with weights 4, 2 and 1") {
+        util::WeightedFairQueue<int, 3> queue({4, 2, 1});
+
+        THEN("it starts empty") {
+            REQUIRE(queue.Empty());
+            REQUIRE(!queue.Pop());
+        }
+
+        WHEN("one class is used") {
+            for (int i = 0; i < 5; ++i)
+                queue.Push(2, i);
+
+            THEN("its elements come out in push order") {
+                for (int i = 0; i < 5; ++i) {
+                    auto item = queue.Pop();
+                    REQUIRE(item);
+                    REQUIRE(item->first == 2);
+                    REQUIRE(item->second == i);
+                }
+                REQUIRE(queue.Empty());
+            }
+        }
+
+        WHEN("all classes are backlogged") {
+            for (int i = 0; i < 700; ++i)
+                for (size_t c = 0; c < 3; ++c)
+                    queue.Push(c, i);
+
+            THEN("they are served in proportion to the weights") {
+                std::array<int, 3> served{};
+                for (int i = 0; i < 700; ++i)
+                    ++served[queue.Pop()->first];
+
+                REQUIRE(served[0] == 400);
+                REQUIRE(served[1] == 200);
+                REQUIRE(served[2] == 100);
+                REQUIRE(queue.Size() == 1400);
+                REQUIRE(queue.Size(0) == 300);
+            }
+        }
+
+        WHEN("a light class arrives behind a long backlog") {
+            for (int i = 0; i < 1000; ++i)
+                queue.Push(2, i);
+            for (int i = 0; i < 10; ++i)
+                queue.Pop();
+
+            queue.Push(0, -1);
+
+            THEN("it does not wait for the backlog") {
+                auto item = queue.Pop();
+                REQUIRE(item->first == 0);
+                REQUIRE(item->second == -1);
+            }
+        }
+    }
+}